@@ -0,0 +1,76 @@
+#include <algorithm>
+#include <atomic>
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+
+#include "alloc.hh"
+
+#ifdef TRACK_ALLOCATIONS
+static std::atomic<uint64_t> allocations = 0;
+
+/* The array, nothrow and sized variants all end up here (or in the matching
+ * `operator delete()'), so these are the only ones replaced.
+ */
+void* operator new(size_t size)
+{
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept
+{
+    free(p);
+}
+
+void operator delete(void* p, size_t) noexcept
+{
+    free(p);
+}
+
+uint64_t alloc::get_count(void)
+{
+    return allocations.load(std::memory_order_relaxed);
+}
+#else
+uint64_t alloc::get_count(void)
+{
+    return 0;
+}
+#endif /* TRACK_ALLOCATIONS */
+
+FrameArena::FrameArena(size_t capacity)
+    : block(new char[capacity]), capacity(capacity)
+{
+}
+
+// `size' bytes aligned to `align' (a power of two), nullptr if it's full.
+void* FrameArena::allocate(size_t size, size_t align)
+{
+    size_t start = (used + align - 1) & ~(align - 1);
+    if (start > capacity || size > capacity - start) return nullptr;
+    used = start + size;
+    return block + start;
+}
+
+/* Format like `printf()' into the arena. Text that doesn't fit anymore is cut
+ * off, it's only shown for a frame anyways.
+ */
+std::string_view FrameArena::format(const char* fmt, ...)
+{
+    char*  text = block + used;
+    size_t room = capacity - used;
+    if (room == 0) return {};
+
+    va_list args;
+    va_start(args, fmt);
+    int length = vsnprintf(text, room, fmt, args);
+    va_end(args);
+    if (length < 0) return {};
+
+    size_t size = std::min<size_t>(length, room - 1);
+    used += size + 1;
+    return { text, size };
+}
@@ -0,0 +1,49 @@
+#ifndef _ALLOC_H_
+#define _ALLOC_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+/* Allocation tracking: built with `TRACK_ALLOCATIONS' defined (debug and
+ * bench builds, see `Makefile'), the global `operator new' counts every call
+ * of every thread, the simulation's included. That's how we check that the
+ * game doesn't touch the heap while it's played. Memory SDL allocates itself
+ * (with `malloc()') isn't counted.
+ * Without the flag, nothing is replaced and the count stays zero.
+ */
+namespace alloc {
+#ifdef TRACK_ALLOCATIONS
+    constexpr bool tracking = true;
+#else
+    constexpr bool tracking = false;
+#endif
+
+    uint64_t get_count(void); // allocations of all threads so far
+}
+
+/* A `FrameArena' hands out memory for data that only lives for one frame,
+ * like formatted text. It's a single block allocated up front; allocating
+ * bumps an offset and `reset()' (at the start of the next frame) frees
+ * everything at once. A full arena doesn't fall back to the heap, it fails.
+ */
+class FrameArena {
+    char*  block;
+    size_t capacity;
+    size_t used = 0;
+public:
+    explicit FrameArena(size_t);
+    FrameArena(const FrameArena&) = delete;
+    ~FrameArena(void) { delete[] block; }
+    FrameArena& operator=(const FrameArena&) = delete;
+
+    void*            allocate(size_t, size_t = alignof(std::max_align_t));
+    std::string_view format(const char*, ...)
+        __attribute__((format(printf, 2, 3)));
+    void             reset(void) { used = 0; }
+
+    size_t get_used(void) const     { return used; }
+    size_t get_capacity(void) const { return capacity; }
+};
+
+#endif /* _ALLOC_H_ */
@@ -0,0 +1,121 @@
+#include <algorithm>
+#include <cstring>
+#include <SDL2/SDL.h>
+
+#include "audio.hh"
+
+/* Open the default audio device and start the callback. The device always
+ * runs at our own format (SDL converts if the hardware differs), so samples
+ * can be converted once when they're loaded. Returns an error message or
+ * `nullptr'.
+ */
+const char* Mixer::open(void)
+{
+    SDL_AudioSpec want;
+    SDL_zero(want);
+    want.freq     = frequency;
+    want.format   = AUDIO_F32SYS;
+    want.channels = channels;
+    want.samples  = buffer_frames;
+    want.callback = callback;
+    want.userdata = this;
+
+    device = SDL_OpenAudioDevice(NULL, 0, &want, NULL, 0);
+    if (device == 0) return SDL_GetError();
+    SDL_PauseAudioDevice(device, 0);
+    return nullptr;
+}
+
+// The callback isn't running anymore once the device is closed.
+void Mixer::close(void)
+{
+    if (device != 0) SDL_CloseAudioDevice(device);
+    device     = 0;
+    num_voices = 0;
+    samples.clear();
+}
+
+/* Decode the WAV file at `path' and convert it to the mixer's format. Loading
+ * the same path again does nothing. Returns an error message or `nullptr'.
+ */
+const char* Mixer::load(const char* path, Sound* sound)
+{
+    auto it = samples.find(path);
+    if (it != samples.end()) {
+        *sound = std::find(sounds.begin(), sounds.end(), &it->second)
+                 - sounds.begin();
+        return nullptr;
+    }
+
+    SDL_AudioSpec spec;
+    uint8_t*      wav_buffer;
+    uint32_t      wav_length;
+    if (SDL_LoadWAV(path, &spec, &wav_buffer, &wav_length) == NULL)
+        return SDL_GetError();
+
+    SDL_AudioCVT cvt;
+    if (SDL_BuildAudioCVT(&cvt, spec.format, spec.channels, spec.freq,
+                          AUDIO_F32SYS, channels, frequency) < 0) {
+        SDL_FreeWAV(wav_buffer);
+        return SDL_GetError();
+    }
+
+    std::vector<uint8_t> buffer(wav_length * cvt.len_mult);
+    memcpy(buffer.data(), wav_buffer, wav_length);
+    SDL_FreeWAV(wav_buffer);
+
+    cvt.buf = buffer.data();
+    cvt.len = wav_length;
+    if (SDL_ConvertAudio(&cvt) != 0) return SDL_GetError();
+
+    Sample& sample = samples[path];
+    uint32_t count = cvt.len_cvt / sizeof(float);
+    sample.data.resize(count);
+    memcpy(sample.data.data(), buffer.data(), count * sizeof(float));
+    *sound = sounds.size();
+    sounds.push_back(&sample);
+    return nullptr;
+}
+
+/* Start playing a sound that was `load()'ed before. Returns false if it
+ * wasn't, or if the callback has too many commands it didn't get to yet.
+ */
+bool Mixer::play(Sound sound, float volume)
+{
+    if (sound >= sounds.size()) return false;
+    return commands.push({ sounds[sound], volume });
+}
+
+void Mixer::callback(void* userdata, uint8_t* stream, int length)
+{
+    Mixer* mixer = (Mixer*)userdata;
+    mixer->mix((float*)stream, length / sizeof(float));
+}
+
+/* Runs on SDL's audio thread: start the sounds that were posted since the
+ * last call, then add all playing sounds up. Sounds that don't fit into
+ * `voices' are dropped.
+ */
+void Mixer::mix(float* out, uint32_t count)
+{
+    Command command;
+    while (commands.pop(&command))
+        if (num_voices < max_voices)
+            voices[num_voices++] = { command.sample, 0, command.volume };
+
+    std::fill(out, out + count, 0.0f);
+    for (uint32_t v = 0; v < num_voices;) {
+        Voice&    voice = voices[v];
+        const std::vector<float>& data = voice.sample->data;
+        uint32_t  n = std::min<uint32_t>(count, data.size() - voice.pos);
+        for (uint32_t i = 0; i < n; i++)
+            out[i] += data[voice.pos + i] * voice.volume;
+        voice.pos += n;
+
+        if (voice.pos >= data.size()) voices[v] = voices[--num_voices];
+        else                          v++;
+    }
+
+    for (uint32_t i = 0; i < count; i++)
+        out[i] = std::clamp(out[i], -1.0f, 1.0f);
+}
@@ -0,0 +1,67 @@
+#ifndef _AUDIO_H_
+#define _AUDIO_H_
+
+#include <cstdint>
+#include <SDL2/SDL.h>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "spsc.hh"
+
+/* The `Mixer' owns the one audio device of the game. Sounds are loaded (and
+ * converted to the device's format) once with `load()', which hands out a
+ * `Sound' to play them by. `play()' then only posts a command to the audio
+ * callback, which mixes all playing sounds into the device's buffer. That way,
+ * playing a sound never touches the disk, the audio device or a lock on the
+ * game thread (nor allocates).
+ */
+class Mixer {
+public:
+    typedef uint32_t Sound; // index in `sounds'
+private:
+    static constexpr int32_t  frequency  = 44100;
+    static constexpr uint8_t  channels   = 2;
+    static constexpr uint16_t buffer_frames = 512;
+    static constexpr uint32_t max_voices = 16; // sounds playing at once
+
+    struct Sample {
+        std::vector<float> data; // interleaved, `channels' floats per frame
+    };
+    struct Voice {
+        const Sample* sample;
+        uint32_t      pos; // next float in `sample->data'
+        float         volume;
+    };
+    struct Command {
+        const Sample* sample;
+        float         volume;
+    };
+
+    SDL_AudioDeviceID device = 0;
+
+    // Only touched by the game thread. Nodes of an `unordered_map' never
+    // move, so the callback can keep pointers to samples.
+    std::unordered_map<std::string, Sample> samples;
+    std::vector<const Sample*>              sounds;  // in `samples'
+    SpscQueue<Command, 64>                  commands;
+
+    // only touched by the audio callback
+    Voice    voices[max_voices];
+    uint32_t num_voices = 0;
+
+    static void callback(void*, uint8_t*, int);
+    void        mix(float*, uint32_t);
+public:
+    Mixer(void) = default;
+    Mixer(const Mixer&) = delete;
+    ~Mixer(void) { close(); }
+    Mixer& operator=(const Mixer&) = delete;
+
+    const char* open(void);
+    void        close(void);
+    const char* load(const char*, Sound*);
+    bool        play(Sound, float = 1.0f);
+};
+
+#endif /* _AUDIO_H_ */
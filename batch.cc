@@ -0,0 +1,289 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+#include "level.hh"
+#include "pool.hh"
+#include "sim.hh"
+
+/* Plays many complete games without a window, to tune the simulation (like
+ * the paddle's reflections, see `-reflections=') and to soak-test it. Every
+ * game is its own `Simulation', seeded by its number, with a bot steering
+ * the paddle:
+ *     follow   keeps the ball over a spot of the paddle that's picked at
+ *              random every time the ball comes down
+ *     random   holds left, right or nothing for a random number of ticks
+ * The games run on a `WorkPool' across all cores. Prints how the games ended,
+ * how long they took and how fast the bricks went, and how many ticks were
+ * simulated per second and core (with `-scaling', for 1, 2, 4... threads).
+ * Linked against the simulation library only.
+ */
+static const int32_t width  = 910; // the size of the game's window
+static const int32_t height = 720;
+
+enum class Bot { FOLLOW, RANDOM };
+
+struct Options {
+    uint32_t                games     = 1000;
+    uint32_t                seed      = 1;
+    Bot                     bot       = Bot::FOLLOW;
+    uint32_t                tick_rate = Simulation::default_tick_rate;
+    uint32_t                max_ticks = 0; // 10 minutes of play by default
+    const level::Map*       map       = nullptr;
+    Simulation::Reflections reflections = Simulation::default_reflections;
+};
+
+struct Result {
+    Simulation::Status status; // still `RUNNING' when it ran out of ticks
+    uint32_t           ticks;
+    uint32_t           bricks; // destroyed
+};
+
+// What every worker adds up, each on a cache line of its own.
+struct alignas(64) Totals {
+    uint64_t ticks = 0;
+    double   busy  = 0.0; // seconds spent playing
+};
+
+struct Batch {
+    const Options*      options;
+    std::vector<Result> results; // by game
+    std::vector<Totals> totals;  // by worker
+};
+
+static void usage(void)
+{
+    std::cerr << "usage: breakout_batch [-games=<n>] [-threads=<n>] "
+                 "[-seed=<n>] [-bot=follow|random]\n"
+                 "                      [-level=<file>] [-tick_rate=<hz>] "
+                 "[-max_ticks=<n>] [-scaling]\n"
+                 "                      [-reflections=<x1>,<y1>,...,"
+                 "<x10>,<y10>]\n";
+    exit(1);
+}
+
+static uint32_t parse_number(const char* value)
+{
+    char* end;
+    unsigned long number = strtoul(value, &end, 10);
+    if (*end != '\0' || number == 0 || number > INT32_MAX) usage();
+    return number;
+}
+
+// One direction per zone of the paddle, see `Simulation::Reflection'.
+static Simulation::Reflections parse_reflections(const char* value)
+{
+    Simulation::Reflections reflections;
+    for (Simulation::Reflection& r: reflections) {
+        char* end;
+        r.x = strtof(value, &end);
+        if (end == value || *end != ',') usage();
+        value = end + 1;
+        r.y = strtof(value, &end);
+        if (end == value || (*end != ',' && *end != '\0') || r.y >= 0.0f)
+            usage(); // the ball has to go up
+        value = end + (*end == ',');
+    }
+    if (*value != '\0') usage();
+    return reflections;
+}
+
+// xorshift32, so the same seed plays the same games everywhere
+static uint32_t next_random(uint32_t* state)
+{
+    uint32_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return *state = x;
+}
+
+static Result play(const Options& options, uint32_t game)
+{
+    Simulation sim = options.map
+                     ? Simulation(*options.map, height, options.tick_rate)
+                     : Simulation(width, height, options.tick_rate);
+    sim.set_reflections(options.reflections);
+
+    // never zero, or xorshift gets stuck
+    uint32_t state = (options.seed * 0x9e3779b9u ^ game) | 1;
+    for (uint32_t i = 0; i < 4; i++) next_random(&state);
+
+    Simulation::Input input;
+    input.launch = true;
+    Result   result = { Simulation::Status::RUNNING, 0, 0 };
+    float    aim    = 0.5f; // where on the paddle, from 0 to 1
+    bool     rising = true;
+    uint32_t hold   = 0;    // ticks the random bot keeps its keys
+    while (result.ticks < options.max_ticks) {
+        const Player& player = sim.get_player();
+        const Ball&   ball   = sim.get_ball();
+        if (options.bot == Bot::FOLLOW) {
+            if (rising && ball.get_yvel() > 0.0f)
+                aim = (next_random(&state) >> 8) * (1.0f / 16777216.0f);
+            rising = ball.get_yvel() < 0.0f;
+
+            float target = player.get_x() + aim * player.get_width();
+            float slack  = player.get_width() * 0.05f;
+            input.left   = ball.get_x() < target - slack;
+            input.right  = ball.get_x() > target + slack;
+        } else if (hold-- == 0) {
+            uint32_t r  = next_random(&state);
+            input.left  = r % 3 == 1;
+            input.right = r % 3 == 2;
+            hold        = r / 3 % options.tick_rate;
+        }
+
+        for (const Simulation::Event& event: sim.step(input))
+            result.bricks += event.type
+                             == Simulation::EventType::BRICK_DESTROYED;
+        input.launch = false;
+        result.ticks++;
+        if (sim.get_status() != Simulation::Status::RUNNING) break;
+    }
+    result.status = sim.get_status();
+    return result;
+}
+
+static void run_game(uint32_t game, uint32_t worker, void* data)
+{
+    Batch* batch = (Batch*)data;
+    auto   start = std::chrono::steady_clock::now();
+    batch->results[game] = play(*batch->options, game);
+    std::chrono::duration<double> busy = std::chrono::steady_clock::now()
+                                         - start;
+    batch->totals[worker].ticks += batch->results[game].ticks;
+    batch->totals[worker].busy  += busy.count();
+}
+
+// Play all games on `threads' threads, returns the wall time in seconds.
+static double run_batch(const Options& options, uint32_t threads,
+                        Batch* batch)
+{
+    WorkPool pool(threads);
+    batch->options = &options;
+    batch->results.assign(options.games, Result());
+    batch->totals.assign(pool.get_workers(), Totals());
+
+    auto start = std::chrono::steady_clock::now();
+    pool.run(options.games, run_game, batch);
+    std::chrono::duration<double> wall = std::chrono::steady_clock::now()
+                                         - start;
+
+    uint64_t steals = 0;
+    for (const WorkPool::Stats& stats: pool.get_stats())
+        steals += stats.steals;
+    uint64_t ticks = 0;
+    double   busy  = 0.0;
+    for (const Totals& totals: batch->totals) {
+        ticks += totals.ticks;
+        busy  += totals.busy;
+    }
+    // per thread: over the whole batch, and only while it was playing
+    printf("%3u threads: %8.3f s, %11.0f ticks/s, per thread %10.0f "
+           "(%10.0f busy), %llu steals\n", pool.get_workers(), wall.count(),
+           ticks / wall.count(), ticks / wall.count() / pool.get_workers(),
+           ticks / busy, (unsigned long long)steals);
+    return wall.count();
+}
+
+// Ticks until the end of the games with `status': mean, median and 95th %.
+static void print_ticks(const char* name, const Batch& batch,
+                        Simulation::Status status, float dt)
+{
+    std::vector<uint32_t> ticks;
+    for (const Result& result: batch.results)
+        if (result.status == status) ticks.push_back(result.ticks);
+    printf("%-8s %8zu games", name, ticks.size());
+    if (ticks.empty()) {
+        printf("\n");
+        return;
+    }
+
+    std::sort(ticks.begin(), ticks.end());
+    double sum = 0.0;
+    for (uint32_t t: ticks) sum += t;
+    printf(", ticks: mean %.0f, median %u, 95%% %u (%.1f s played on "
+           "average)\n", sum / ticks.size(), ticks[ticks.size() / 2],
+           ticks[ticks.size() * 95 / 100], sum / ticks.size() * dt);
+}
+
+static void print_results(const Batch& batch, float dt)
+{
+    print_ticks("won", batch, Simulation::Status::WON, dt);
+    print_ticks("lost", batch, Simulation::Status::LOST, dt);
+    print_ticks("timeout", batch, Simulation::Status::RUNNING, dt);
+
+    uint64_t bricks = 0, ticks = 0;
+    for (const Result& result: batch.results) {
+        bricks += result.bricks;
+        ticks  += result.ticks;
+    }
+    printf("bricks:  %llu destroyed, %.2f per second of play\n",
+           (unsigned long long)bricks, ticks ? bricks / (ticks * dt) : 0.0);
+}
+
+int main(int argc, char** argv)
+{
+    Options     options;
+    uint32_t    threads    = 0; // one per core
+    bool        scaling    = false;
+    const char* level_path = nullptr;
+    for (int i = 1; i < argc; i++) {
+        if (strncmp(argv[i], "-games=", 7) == 0)
+            options.games = parse_number(argv[i] + 7);
+        else if (strncmp(argv[i], "-threads=", 9) == 0)
+            threads = parse_number(argv[i] + 9);
+        else if (strncmp(argv[i], "-seed=", 6) == 0)
+            options.seed = parse_number(argv[i] + 6);
+        else if (strcmp(argv[i], "-bot=follow") == 0)
+            options.bot = Bot::FOLLOW;
+        else if (strcmp(argv[i], "-bot=random") == 0)
+            options.bot = Bot::RANDOM;
+        else if (strncmp(argv[i], "-level=", 7) == 0 && argv[i][7] != '\0')
+            level_path = argv[i] + 7;
+        else if (strncmp(argv[i], "-tick_rate=", 11) == 0)
+            options.tick_rate = parse_number(argv[i] + 11);
+        else if (strncmp(argv[i], "-max_ticks=", 11) == 0)
+            options.max_ticks = parse_number(argv[i] + 11);
+        else if (strncmp(argv[i], "-reflections=", 13) == 0)
+            options.reflections = parse_reflections(argv[i] + 13);
+        else if (strcmp(argv[i], "-scaling") == 0)
+            scaling = true;
+        else
+            usage();
+    }
+    if (options.max_ticks == 0) options.max_ticks = options.tick_rate * 600;
+
+    // shared by all games, they only read it
+    level::Map map;
+    if (level_path) {
+        if (const char* error = map.open(level_path)) {
+            std::cerr << "error: " << error << '\n';
+            return 1;
+        }
+        options.map = &map;
+    }
+
+    Batch batch;
+    if (scaling) {
+        if (threads == 0) threads = WorkPool(0).get_workers();
+        double single = 0.0;
+        for (uint32_t n = 1; n < threads * 2; n *= 2) {
+            n = std::min(n, threads);
+            double wall = run_batch(options, n, &batch);
+            if (n == 1) single = wall;
+            printf("%15s speedup %.2f, efficiency %.0f%%\n", "",
+                   single / wall, single / wall / n * 100.0);
+        }
+    } else {
+        run_batch(options, threads, &batch);
+    }
+    print_results(batch, 1.0f / options.tick_rate);
+    return 0;
+}
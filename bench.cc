@@ -0,0 +1,706 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <memory>
+#include <SDL2/SDL.h>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "alloc.hh"
+#include "context.hh"
+#include "game.hh"
+#include "level.hh"
+#include "particles.hh"
+#include "scores.hh"
+#include "shapes.hh"
+#include "sim.hh"
+#include "ui.hh"
+
+/* Micro-benchmarks, run them with `make bench'. Everything is drawn with the
+ * software renderer into an offscreen surface, so no window (and no GPU) is
+ * needed and the numbers include the actual rasterization work.
+ * Every measurement is a `Result', all of them are written as JSON and can be
+ * compared against the results of an earlier run (see `usage()').
+ */
+static const int32_t   surface_width  = 910;
+static const int32_t   surface_height = 720;
+static const double    time_budget    = 0.2; // seconds per measurement
+static const SDL_Color black          = { 15, 15, 15, 255 };
+
+struct Result {
+    std::string name;
+    double      value; // lower is better
+    std::string unit;
+};
+static std::vector<Result> results;
+
+static void usage(void)
+{
+    std::cerr << "usage: breakout_bench [-out=<file>] [-baseline=<file>] "
+                 "[-threshold=<percent>]\n"
+                 "  -out        write the results as JSON\n"
+                 "  -baseline   compare against an earlier `-out' file, "
+                 "exit with 1 on regressions\n"
+                 "  -threshold  slowdown that counts as a regression "
+                 "(default 10)\n";
+    exit(1);
+}
+
+/* Run `fn' until the time budget is used up and return the average time per
+ * call in nanoseconds.
+ */
+template <typename F>
+static double measure(F fn)
+{
+    const double freq = SDL_GetPerformanceFrequency();
+    uint64_t     start = SDL_GetPerformanceCounter();
+    uint64_t     iterations = 0;
+    double       elapsed = 0.0;
+    do {
+        fn();
+        iterations++;
+        elapsed = (SDL_GetPerformanceCounter() - start) / freq;
+    } while (elapsed < time_budget || iterations < 3);
+    return elapsed * 1e9 / iterations;
+}
+
+static void record(const std::string& name, double value, const char* unit)
+{
+    printf("%-40s %12.1f %s\n", name.c_str(), value, unit);
+    results.push_back({ name, value, unit });
+}
+
+/* Compare the different ways of drawing `count' circles of the same size. One
+ * "frame" is drawing all of them and flushing the renderer.
+ */
+static void bench_circles(SDL_Renderer* renderer)
+{
+    shapes::CircleSprites sprites;
+
+    for (int32_t diameter: { 16, 35, 64, 128, 256 })
+        for (uint32_t count: { 1, 16, 256 }) {
+            std::vector<shapes::Circle> circles;
+            for (uint32_t i = 0; i < count; i++)
+                circles.emplace_back(
+                        (i * 97) % surface_width, (i * 57) % surface_height,
+                        diameter);
+
+            auto run = [&](const char* name, auto draw) {
+                double ns = measure([&](void) {
+                    for (const shapes::Circle& c: circles) draw(c);
+                    SDL_RenderFlush(renderer);
+                });
+                record(std::string(name) + "/d=" + std::to_string(diameter) +
+                       "/n=" + std::to_string(count), ns / count,
+                       "ns/circle");
+            };
+
+            SDL_SetRenderDrawColor(renderer, black.r, black.g, black.b,
+                                   black.a);
+            run("circle/render", [&](const shapes::Circle& c) {
+                c.render(renderer);
+            });
+            run("circle/render1", [&](const shapes::Circle& c) {
+                c.render1(renderer);
+            });
+            std::vector<SDL_Vertex> vertices;
+            std::vector<int>        indices;
+            run("circle/spans", [&](const shapes::Circle& c) {
+                c.render_spans(renderer, black, vertices, indices);
+            });
+            run("circle/sprite", [&](const shapes::Circle& c) {
+                sprites.render(renderer, c, black, false);
+            });
+            run("circle/sprite_aa", [&](const shapes::Circle& c) {
+                sprites.render(renderer, c, black, true);
+            });
+        }
+
+    sprites.clear();
+}
+
+/* Fill the upper part of a `width' x `height' level with roughly `count' tough
+ * blocks, so the ball keeps bouncing around in a dense field.
+ */
+static std::vector<Block> dense_level(int32_t width, int32_t height,
+                                      uint32_t count)
+{
+    const int32_t field_height = height - 400;
+    const int32_t pitch = std::max(4.0, sqrt((double)width * field_height /
+                                             count));
+    const int32_t bw = std::max(2, pitch * 4 / 5);
+    const int32_t bh = std::max(2, pitch / 2);
+
+    std::vector<Block> blocks;
+    for (int32_t y = 0; y + bh <= field_height; y += pitch)
+        for (int32_t x = 0; x + bw <= width; x += pitch)
+            if (blocks.size() < count)
+                blocks.emplace_back(x, y, bw, bh, 127);
+    return blocks;
+}
+
+/* The cost of one simulation tick (mostly brick collision) for increasingly
+ * dense levels. The paddle follows the ball; if the ball is lost anyways, the
+ * level is rebuilt without counting the time.
+ */
+static void bench_collision(void)
+{
+    const int32_t  width = 4000, height = 4000;
+    const uint32_t ticks = 200000;
+    const double   freq  = SDL_GetPerformanceFrequency();
+
+    for (uint32_t count: { 1000, 10000, 50000, 100000 }) {
+        std::vector<Block> level = dense_level(width, height, count);
+        auto sim = std::make_unique<Simulation>(width, height, level);
+        Simulation::Input input;
+        input.launch = true;
+
+        uint64_t total = 0;
+        for (uint32_t tick = 0; tick < ticks; tick++) {
+            if (sim->get_status() != Simulation::Status::RUNNING) {
+                sim = std::make_unique<Simulation>(width, height, level);
+                input.launch = true;
+            }
+
+            const Player& player = sim->get_player();
+            float target = player.get_xpos() + player.get_width() / 2.0f;
+            input.left  = sim->get_ball().get_x() < target;
+            input.right = !input.left;
+
+            uint64_t start = SDL_GetPerformanceCounter();
+            sim->step(input);
+            total += SDL_GetPerformanceCounter() - start;
+            input.launch = false;
+        }
+        record("collision/step/blocks=" + std::to_string(level.size()),
+               total / freq * 1e9 / ticks, "ns/tick");
+    }
+}
+
+/* Stress test for the ball pool: the cost of one tick with more and more
+ * balls bouncing around a dense field at once, per tick and per ball. The
+ * paddle follows the lead ball; once a quarter of the balls (or the game) is
+ * lost, the level is rebuilt without counting the time.
+ */
+static void bench_balls(void)
+{
+    const int32_t  width = 2000, height = 900;
+    const uint32_t ticks = 2000;
+    const double   freq  = SDL_GetPerformanceFrequency();
+    const std::vector<Block> level = dense_level(width, height, 5000);
+
+    for (uint32_t count: { 1, 10, 100, 1000, 4000 }) {
+        std::unique_ptr<Simulation> sim;
+        Simulation::Input input;
+
+        uint64_t total = 0;
+        for (uint32_t tick = 0; tick < ticks; tick++) {
+            if (!sim || sim->get_status() != Simulation::Status::RUNNING ||
+                sim->get_balls().count() < (count * 3 + 3) / 4) {
+                sim = std::make_unique<Simulation>(width, height, level);
+                sim->spawn_balls(count - 1, tick + 1);
+                input.launch = true;
+            }
+
+            const Player& player = sim->get_player();
+            float target = player.get_xpos() + player.get_width() / 2.0f;
+            input.left  = sim->get_ball().get_x() < target;
+            input.right = !input.left;
+
+            uint64_t start = SDL_GetPerformanceCounter();
+            sim->step(input);
+            total += SDL_GetPerformanceCounter() - start;
+            input.launch = false;
+        }
+        double ns = total / freq * 1e9 / ticks;
+        std::string n = "/balls=" + std::to_string(count);
+        record("balls/step" + n, ns, "ns/tick");
+        record("balls/step_per_ball" + n, ns / count, "ns/ball");
+    }
+}
+
+/* The circle-vs-block test itself, once with SIMD and once scalar: a brute
+ * force query over all blocks (half of them destroyed) and a filter over a
+ * fixed set of candidates like the ones the grid returns.
+ */
+static void bench_overlap(void)
+{
+    const int32_t width = 4000, height = 4000;
+
+    for (uint32_t count: { 1000, 10000, 100000 }) {
+        BlockStore store;
+        for (const Block& block: dense_level(width, height, count))
+            store.add(block.get_rect(), block.get_strength());
+        for (uint32_t i = 0; i < store.size(); i += 2) store.kill(i);
+
+        std::vector<uint32_t> all;
+        for (uint32_t i: store.get_alive()) all.push_back(i);
+        std::vector<uint32_t> out, indices;
+
+        for (bool vectorized: { false, true }) {
+            BlockStore::set_vectorized(vectorized);
+            uint32_t q = 0;
+            double ns = measure([&](void) {
+                float cx = (q * 97) % width, cy = (q * 57) % (height - 400);
+                q++;
+                out.clear();
+                store.query(cx, cy, 17.5f, out);
+            });
+            std::string variant = vectorized ? "_simd" : "_scalar";
+            std::string blocks  = "/blocks=" + std::to_string(store.size());
+            record("overlap/query" + variant + blocks, ns, "ns/query");
+
+            ns = measure([&](void) {
+                float cx = (q * 97) % width, cy = (q * 57) % (height - 400);
+                q++;
+                indices = all;
+                store.filter_overlapping(cx, cy, 17.5f, indices.data(),
+                                         indices.size());
+            });
+            record("overlap/filter" + variant + blocks, ns / store.count(),
+                   "ns/block");
+        }
+        BlockStore::set_vectorized(true);
+    }
+}
+
+/* Opening a level: mapping a level file (which checks its header and chunk
+ * table) and starting a simulation that streams it in, against building a
+ * simulation from the same bricks in memory. Rows of bricks are laid out like
+ * `breakout_levelgen' does, the file goes to the temp directory.
+ */
+static void bench_level(void)
+{
+    namespace fs = std::filesystem;
+    const int32_t width = surface_width, view = surface_height;
+    const std::string path = (fs::temp_directory_path() /
+                              "breakout_bench.lvl").string();
+
+    for (int32_t rows: { 1000, 100000 }) {
+        std::vector<Block> bricks;
+        for (int32_t y = 0; y < rows; y++)
+            for (int32_t x = 0; x < 10; x++)
+                bricks.emplace_back(x * 90 + 10, y * 45 + 5, 80, 40,
+                                    (x + y) % 4 + 1);
+        const int32_t height = rows * 45 + 405;
+        if (const char* error = level::write(path.c_str(), width, height,
+                                             256, bricks)) {
+            std::cerr << "error: " << error << '\n';
+            exit(1);
+        }
+        std::string n = "/bricks=" + std::to_string(bricks.size());
+
+        level::Map map;
+        double ns = measure([&](void) {
+            if (map.open(path.c_str())) exit(1);
+        });
+        record("level/open" + n, ns, "ns/open");
+        ns = measure([&](void) { Simulation sim(map, view); });
+        record("level/start_streamed" + n, ns, "ns/start");
+        ns = measure([&](void) { Simulation sim(width, height, bricks); });
+        record("level/start_in_memory" + n, ns, "ns/start");
+        map.close();
+    }
+    fs::remove(path);
+}
+
+/* High scores: opening a store of many games with its index (only the index
+ * and an empty tail are read) and without it (the whole log is scanned and
+ * the index rebuilt), then ranking and submitting scores. The files go to
+ * the temp directory.
+ */
+static void bench_scores(void)
+{
+    namespace fs = std::filesystem;
+    const std::string path = (fs::temp_directory_path() /
+                              "breakout_bench.scores").string();
+    const std::string index = path + ".idx";
+
+    for (uint32_t games: { 100000, 2000000 }) {
+        fs::remove(path);
+        fs::remove(index);
+        scores::Store store;
+        if (const char* error = store.open(path.c_str())) {
+            std::cerr << "error: " << error << '\n';
+            exit(1);
+        }
+        uint32_t random = 1;
+        for (uint32_t i = 0; i < games; i++) {
+            random = random * 1664525 + 1013904223;
+            store.submit(random >> 12, i);
+        }
+        store.close(); // everything is written, the index too
+        std::string n = "/games=" + std::to_string(games);
+
+        double ns = measure([&](void) {
+            if (store.open(path.c_str())) exit(1);
+            store.close();
+        });
+        record("scores/open" + n, ns, "ns/open");
+        ns = measure([&](void) {
+            fs::remove(index);
+            if (store.open(path.c_str())) exit(1);
+            store.close();
+        });
+        record("scores/open_rebuild" + n, ns, "ns/open");
+    }
+
+    scores::Store store;
+    if (store.open(path.c_str())) exit(1);
+    uint32_t score = 0;
+    double ns = measure([&](void) {
+        if (store.rank(score += 4099) > scores::top_k + 1) exit(1);
+    });
+    record("scores/rank", ns, "ns/rank");
+    ns = measure([&](void) { store.submit(score += 4099, 0); });
+    record("scores/submit", ns, "ns/submit");
+    store.close();
+
+    fs::remove(path);
+    fs::remove(index);
+}
+
+/* Particle stress test: one frame is moving all particles by 1/60 s, building
+ * their quads and drawing them with a single `SDL_RenderGeometry()' on the
+ * software renderer. Particles are respawned across the surface every 30
+ * frames (not timed), so they don't all fall out of view. Prints the most
+ * particles that still fit into a 60 Hz frame.
+ */
+static void bench_particles(SDL_Renderer* renderer)
+{
+    const double   freq   = SDL_GetPerformanceFrequency();
+    const uint32_t frames = 120;
+    const SDL_Rect area   = { 0, 0, surface_width, surface_height / 2 };
+    const ParticlePool::Spray spray = { { 190, 80, 40, 255 }, 300.0f, 1e6f,
+                                        4.0f };
+    uint32_t budget = 0;
+
+    for (uint32_t count: { 1000, 10000, 50000, 100000 }) {
+        ParticlePool pool(count);
+        std::string  n = "/particles=" + std::to_string(count);
+
+        pool.spawn(area, count, spray);
+        for (bool vectorized: { false, true }) {
+            ParticlePool::set_vectorized(vectorized);
+            double ns = measure([&](void) { pool.update(1.0f / 60.0f); });
+            record(std::string("particles/update") +
+                   (vectorized ? "_simd" : "_scalar") + n, ns / count,
+                   "ns/particle");
+        }
+
+        uint64_t total = 0;
+        for (uint32_t frame = 0; frame < frames; frame++) {
+            if (frame % 30 == 0) {
+                pool.clear();
+                pool.spawn(area, count, spray);
+            }
+            uint64_t start = SDL_GetPerformanceCounter();
+            pool.update(1.0f / 60.0f);
+            uint32_t num_indices = pool.build(0);
+            SDL_RenderGeometry(renderer, nullptr, pool.get_vertices(),
+                               pool.get_count() * 4, pool.get_indices(),
+                               num_indices);
+            SDL_RenderFlush(renderer);
+            total += SDL_GetPerformanceCounter() - start;
+        }
+        double ms = total / freq * 1e3 / frames;
+        record("particles/frame" + n, ms * 1e6, "ns/frame");
+        if (ms <= 1000.0 / 60.0) budget = count;
+    }
+    printf("%-40s %12u particles\n", "particles/budget@16.6ms", budget);
+}
+
+/* Drawing through `Context' (text, textures, buttons), each measured as a
+ * whole frame including `render_present()'. The context needs the game's
+ * font and texture directory, so these are skipped if the assets are missing.
+ */
+static void bench_context(void)
+{
+    namespace fs = std::filesystem;
+    if (!fs::exists("./assets/fonts/OpenSans-Bold.ttf") ||
+        !fs::is_directory("./assets/textures")) {
+        std::cerr << "skipping context benchmarks, assets are missing\n";
+        return;
+    }
+
+    Context context(true);
+
+    auto frame = [&](const std::string& name, auto draw) {
+        double ns = measure([&](void) {
+            context.clear_renderer();
+            draw();
+            context.render_present();
+        });
+        record(name, ns, "ns/frame");
+    };
+
+    const std::string line = "Score: 1234567890";
+    frame("context/text/1", [&](void) {
+        context.draw_text(line, black, 10, 10);
+    });
+    frame("context/text/32", [&](void) {
+        for (int32_t i = 0; i < 32; i++)
+            context.draw_text(line, black, 10, i * 20, i % 2 ? 24 : 36);
+    });
+
+    // a texture that isn't in the atlas, so it goes through the cache
+    std::string image = (fs::temp_directory_path() / "breakout_bench.bmp");
+    SDL_Surface* surface = SDL_CreateRGBSurfaceWithFormat(
+            0, 256, 256, 32, SDL_PIXELFORMAT_RGBA32);
+    if (!surface || SDL_SaveBMP(surface, image.c_str()) != 0)
+        context.quit_on_error(SDL_GetError());
+    SDL_FreeSurface(surface);
+
+    SDL_Rect dest = { 100, 100, 80, 40 };
+    TextureCache::Handle handle = context.load_texture(image.c_str());
+    frame("context/texture/hit", [&](void) {
+        context.draw_texture(handle, dest);
+    });
+    // without a budget, every frame evicts the texture and loads it again
+    context.set_texture_budget(0);
+    frame("context/texture/miss", [&](void) {
+        context.draw_texture(handle, dest);
+    });
+    context.set_texture_budget(256 * 1024 * 1024);
+    fs::remove(image);
+
+    ui::Button button(10, 10, 250, 80);
+    button.add_text("Hello Coco", context.get_font(), context);
+    frame("context/button", [&](void) {
+        button.render(context, -1, -1);
+    });
+
+    /* Bricks drawn every frame, against a layer that caches them and is only
+     * copied (or patched where one brick changed). The layer shouldn't get
+     * slower with more bricks.
+     */
+    RenderLayer layer;
+    context.create_layer(layer);
+    for (int32_t count: { 100, 4000 }) {
+        std::vector<SDL_Rect> bricks;
+        for (int32_t i = 0; i < count; i++)
+            bricks.push_back({ i % 50 * 18, i / 50 * 9, 16, 8 });
+        std::string n = "/n=" + std::to_string(count);
+
+        frame("context/bricks/direct" + n, [&](void) {
+            for (const SDL_Rect& r: bricks) context.draw_rectangle(black, r);
+        });
+
+        layer.invalidate();
+        context.begin_layer(layer);
+        for (const SDL_Rect& r: bricks) context.draw_rectangle(black, r);
+        context.end_layer(layer);
+        frame("context/bricks/layer" + n, [&](void) {
+            context.draw_layer(layer);
+        });
+        frame("context/bricks/patch" + n, [&](void) {
+            layer.invalidate(bricks[count / 2]);
+            context.begin_layer(layer);
+            context.draw_rectangle(black, bricks[count / 2]);
+            context.end_layer(layer);
+            context.draw_layer(layer);
+        });
+    }
+}
+
+/* The zero allocation guarantee: once the game is PLAYING, neither a frame
+ * (taking the latest snapshot, drawing it with the FPS overlay and presenting
+ * it) nor the ticks the session simulates in the meantime may allocate. The
+ * game runs offscreen with the paddle steered after the ball; after a second
+ * to warm up, all allocations (of any thread) from the end of one frame to
+ * the end of the next are counted against every frame that ends in PLAYING.
+ * Returns false if any of them allocated.
+ */
+static bool check_frame_allocations(void)
+{
+    namespace fs = std::filesystem;
+    if (!alloc::tracking) {
+        std::cerr << "skipping the allocation check, built without "
+                     "TRACK_ALLOCATIONS\n";
+        return true;
+    }
+    if (!fs::exists("./assets/fonts/OpenSans-Bold.ttf") ||
+        !fs::is_directory("./assets/textures") ||
+        !fs::is_directory("./assets/sounds")) {
+        std::cerr << "skipping the allocation check, assets are missing\n";
+        return true;
+    }
+
+    Game        game(true, Simulation::default_tick_rate, nullptr, true);
+    InputQueue& input = game.get_input();
+    auto key = [&](SDL_Scancode code, bool down) {
+        SDL_Event event;
+        SDL_zero(event);
+        event.type = down ? SDL_KEYDOWN : SDL_KEYUP;
+        event.key.timestamp = SDL_GetTicks();
+        event.key.keysym.scancode = code;
+        input.handle(event);
+    };
+
+    game.get_session().start();
+    key(SDL_SCANCODE_RETURN, true); // start playing and launch the ball
+    key(SDL_SCANCODE_RETURN, false);
+
+    const uint32_t warm_up = SDL_GetTicks() + 1000;
+    uint32_t frames = 0, allocating = 0;
+    uint64_t total = 0, before = alloc::get_count();
+    while (frames < 600) {
+        game.update();
+        const Snapshot& snapshot = game.get_session().get_snapshot();
+        if (snapshot.state != GameState::PLAYING) {
+            if (SDL_GetTicks() > warm_up) break; // lost (or won) already
+            game.render();
+            before = alloc::get_count();
+            continue;
+        }
+
+        float target = snapshot.player.get_rect().x +
+                       snapshot.player.get_rect().w / 2.0f;
+        bool  left   = snapshot.balls.front().get_x() < target;
+        key(SDL_SCANCODE_LEFT, left);
+        key(SDL_SCANCODE_RIGHT, !left);
+
+        game.render();
+        uint64_t now = alloc::get_count();
+        uint64_t count = now - before;
+        before = now;
+        if (SDL_GetTicks() < warm_up) continue;
+
+        total      += count;
+        allocating += count > 0;
+        frames++;
+    }
+    game.get_session().stop();
+
+    printf("%-40s %12u frames, %u allocating\n", "frame/allocations",
+           frames, allocating);
+    if (allocating > 0) {
+        std::cerr << "error: " << total << " allocations in " << allocating
+                  << " of " << frames << " frames while playing\n";
+        return false;
+    }
+    return true;
+}
+
+static void write_json(const char* path)
+{
+    FILE* file = fopen(path, "w");
+    if (!file) {
+        std::cerr << "error: unable to write " << path << '\n';
+        exit(1);
+    }
+    // one result per line, `read_baseline()' depends on that
+    fprintf(file, "{\"results\": [\n");
+    for (uint32_t i = 0; i < results.size(); i++)
+        fprintf(file,
+                "  {\"name\": \"%s\", \"value\": %.3f, \"unit\": \"%s\"}%s\n",
+                results[i].name.c_str(), results[i].value,
+                results[i].unit.c_str(), i + 1 < results.size() ? "," : "");
+    fprintf(file, "]}\n");
+    fclose(file);
+}
+
+static std::unordered_map<std::string, double> read_baseline(const char* path)
+{
+    std::unordered_map<std::string, double> baseline;
+    FILE* file = fopen(path, "r");
+    if (!file) {
+        std::cerr << "error: unable to read " << path << '\n';
+        exit(1);
+    }
+    char line[512], name[256];
+    double value;
+    while (fgets(line, sizeof(line), file))
+        if (sscanf(line, " {\"name\": \"%255[^\"]\", \"value\": %lf", name,
+                   &value) == 2)
+            baseline[name] = value;
+    fclose(file);
+    return baseline;
+}
+
+/* Print how every result changed relative to the baseline and return the
+ * number of regressions (results that got slower by more than `threshold'
+ * percent).
+ */
+static uint32_t compare(const char* path, double threshold)
+{
+    std::unordered_map<std::string, double> baseline = read_baseline(path);
+    uint32_t regressions = 0;
+
+    printf("\n%-40s %12s %12s %8s\n", "compared to baseline", "before",
+           "after", "change");
+    for (const Result& result: results) {
+        auto it = baseline.find(result.name);
+        if (it == baseline.end() || it->second <= 0.0) continue;
+
+        double change = (result.value / it->second - 1.0) * 100.0;
+        const char* verdict = "";
+        if (change > threshold) {
+            verdict = "  REGRESSION";
+            regressions++;
+        } else if (change < -threshold) {
+            verdict = "  improved";
+        }
+        printf("%-40s %12.1f %12.1f %+7.1f%%%s\n", result.name.c_str(),
+               it->second, result.value, change, verdict);
+    }
+    printf("%u regression(s) over %.0f%%\n", regressions, threshold);
+    return regressions;
+}
+
+int main(int argc, char** argv)
+{
+    const char* out_path      = nullptr;
+    const char* baseline_path = nullptr;
+    double      threshold     = 10.0;
+    for (int i = 1; i < argc; i++) {
+        if (strncmp(argv[i], "-out=", 5) == 0)
+            out_path = argv[i] + 5;
+        else if (strncmp(argv[i], "-baseline=", 10) == 0)
+            baseline_path = argv[i] + 10;
+        else if (strncmp(argv[i], "-threshold=", 11) == 0)
+            threshold = atof(argv[i] + 11);
+        else
+            usage();
+    }
+
+    if (SDL_Init(SDL_INIT_TIMER) != 0) {
+        std::cerr << "error: " << SDL_GetError() << '\n';
+        return 1;
+    }
+
+    SDL_Surface* target = SDL_CreateRGBSurfaceWithFormat(0, surface_width,
+                                                         surface_height, 32,
+                                                         SDL_PIXELFORMAT_RGBA32);
+    SDL_Renderer* renderer = target ? SDL_CreateSoftwareRenderer(target)
+                                    : nullptr;
+    if (!renderer) {
+        std::cerr << "error: " << SDL_GetError() << '\n';
+        return 1;
+    }
+    SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_BLEND);
+
+    bench_circles(renderer);
+    bench_collision();
+    bench_balls();
+    bench_overlap();
+    bench_level();
+    bench_scores();
+    bench_particles(renderer);
+
+    SDL_DestroyRenderer(renderer);
+    SDL_FreeSurface(target);
+
+    bench_context(); // initializes (and quits) SDL on its own
+    bool frames_ok = check_frame_allocations(); // same
+    SDL_Quit();
+
+    if (out_path) write_json(out_path);
+    if (baseline_path && compare(baseline_path, threshold) > 0) return 1;
+    return frames_ok ? 0 : 1;
+}
@@ -0,0 +1,285 @@
+#include <algorithm>
+#include <cstdint>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define BLOCKS_X86 1
+#endif
+
+#include "blocks.hh"
+
+/* All variants of the circle-vs-block test answer the same question: is the
+ * point of the block closest to the circle's midpoint (cx,cy) at most `r' away?
+ * `r2' is `r' squared.
+ */
+static inline bool overlaps(float cx, float cy, float r2, int32_t x,
+                            int32_t y, int32_t w, int32_t h)
+{
+    float nx = std::min(std::max(cx, (float)x), (float)(x + w));
+    float ny = std::min(std::max(cy, (float)y), (float)(y + h));
+    float dx = cx - nx, dy = cy - ny;
+    return dx*dx + dy*dy <= r2;
+}
+
+enum class Isa { SCALAR, SSE2, AVX2 };
+
+static Isa detect_isa(void)
+{
+#ifdef BLOCKS_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) return Isa::AVX2;
+    if (__builtin_cpu_supports("sse2")) return Isa::SSE2;
+#endif
+    return Isa::SCALAR;
+}
+
+static const Isa best_isa = detect_isa();
+static Isa       isa      = best_isa;
+
+#ifdef BLOCKS_X86
+__attribute__((target("avx2")))
+static inline __m256 overlaps8(__m256 cx, __m256 cy, __m256 r2, __m256i x,
+                               __m256i y, __m256i w, __m256i h)
+{
+    __m256 x0 = _mm256_cvtepi32_ps(x);
+    __m256 y0 = _mm256_cvtepi32_ps(y);
+    __m256 x1 = _mm256_cvtepi32_ps(_mm256_add_epi32(x, w));
+    __m256 y1 = _mm256_cvtepi32_ps(_mm256_add_epi32(y, h));
+    __m256 dx = _mm256_sub_ps(cx, _mm256_min_ps(_mm256_max_ps(cx, x0), x1));
+    __m256 dy = _mm256_sub_ps(cy, _mm256_min_ps(_mm256_max_ps(cy, y0), y1));
+    __m256 d2 = _mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy));
+    return _mm256_cmp_ps(d2, r2, _CMP_LE_OQ);
+}
+
+__attribute__((target("sse2")))
+static inline __m128 overlaps4(__m128 cx, __m128 cy, __m128 r2, __m128i x,
+                               __m128i y, __m128i w, __m128i h)
+{
+    __m128 x0 = _mm_cvtepi32_ps(x);
+    __m128 y0 = _mm_cvtepi32_ps(y);
+    __m128 x1 = _mm_cvtepi32_ps(_mm_add_epi32(x, w));
+    __m128 y1 = _mm_cvtepi32_ps(_mm_add_epi32(y, h));
+    __m128 dx = _mm_sub_ps(cx, _mm_min_ps(_mm_max_ps(cx, x0), x1));
+    __m128 dy = _mm_sub_ps(cy, _mm_min_ps(_mm_max_ps(cy, y0), y1));
+    __m128 d2 = _mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy));
+    return _mm_cmple_ps(d2, r2);
+}
+
+// Candidates are scattered over the store, so AVX2 gathers them 8 at a time.
+__attribute__((target("avx2")))
+static uint32_t filter_avx2(const int32_t* xs, const int32_t* ys,
+                            const int32_t* ws, const int32_t* hs, float cx,
+                            float cy, float r2, uint32_t* indices, uint32_t n)
+{
+    const __m256 vcx = _mm256_set1_ps(cx);
+    const __m256 vcy = _mm256_set1_ps(cy);
+    const __m256 vr2 = _mm256_set1_ps(r2);
+
+    uint32_t kept = 0, i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256i idx = _mm256_loadu_si256((const __m256i*)(indices + i));
+        __m256  hit = overlaps8(vcx, vcy, vr2,
+                                _mm256_i32gather_epi32(xs, idx, 4),
+                                _mm256_i32gather_epi32(ys, idx, 4),
+                                _mm256_i32gather_epi32(ws, idx, 4),
+                                _mm256_i32gather_epi32(hs, idx, 4));
+        uint32_t mask = _mm256_movemask_ps(hit);
+        uint32_t lane[8];
+        _mm256_storeu_si256((__m256i*)lane, idx);
+        for (; mask; mask &= mask - 1)
+            indices[kept++] = lane[__builtin_ctz(mask)];
+    }
+    for (; i < n; i++) {
+        uint32_t b = indices[i];
+        if (overlaps(cx, cy, r2, xs[b], ys[b], ws[b], hs[b]))
+            indices[kept++] = b;
+    }
+    return kept;
+}
+
+__attribute__((target("sse2")))
+static uint32_t filter_sse2(const int32_t* xs, const int32_t* ys,
+                            const int32_t* ws, const int32_t* hs, float cx,
+                            float cy, float r2, uint32_t* indices, uint32_t n)
+{
+    const __m128 vcx = _mm_set1_ps(cx);
+    const __m128 vcy = _mm_set1_ps(cy);
+    const __m128 vr2 = _mm_set1_ps(r2);
+
+    uint32_t kept = 0, i = 0;
+    for (; i + 4 <= n; i += 4) {
+        uint32_t a = indices[i],   b = indices[i+1];
+        uint32_t c = indices[i+2], d = indices[i+3];
+        __m128 hit = overlaps4(vcx, vcy, vr2,
+                               _mm_setr_epi32(xs[a], xs[b], xs[c], xs[d]),
+                               _mm_setr_epi32(ys[a], ys[b], ys[c], ys[d]),
+                               _mm_setr_epi32(ws[a], ws[b], ws[c], ws[d]),
+                               _mm_setr_epi32(hs[a], hs[b], hs[c], hs[d]));
+        uint32_t mask = _mm_movemask_ps(hit);
+        uint32_t lane[4] = { a, b, c, d };
+        for (; mask; mask &= mask - 1)
+            indices[kept++] = lane[__builtin_ctz(mask)];
+    }
+    for (; i < n; i++) {
+        uint32_t b = indices[i];
+        if (overlaps(cx, cy, r2, xs[b], ys[b], ws[b], hs[b]))
+            indices[kept++] = b;
+    }
+    return kept;
+}
+
+/* Test the blocks [first, first+64) of one bitmask word against the circle.
+ * The caller makes sure that all 64 blocks exist.
+ */
+__attribute__((target("avx2")))
+static uint64_t scan_word_avx2(const int32_t* xs, const int32_t* ys,
+                               const int32_t* ws, const int32_t* hs, float cx,
+                               float cy, float r2, uint32_t first)
+{
+    const __m256 vcx = _mm256_set1_ps(cx);
+    const __m256 vcy = _mm256_set1_ps(cy);
+    const __m256 vr2 = _mm256_set1_ps(r2);
+
+    uint64_t hits = 0;
+    for (uint32_t i = 0; i < 64; i += 8) {
+        uint32_t b = first + i;
+        __m256 hit = overlaps8(vcx, vcy, vr2,
+                               _mm256_loadu_si256((const __m256i*)(xs + b)),
+                               _mm256_loadu_si256((const __m256i*)(ys + b)),
+                               _mm256_loadu_si256((const __m256i*)(ws + b)),
+                               _mm256_loadu_si256((const __m256i*)(hs + b)));
+        hits |= (uint64_t)_mm256_movemask_ps(hit) << i;
+    }
+    return hits;
+}
+
+__attribute__((target("sse2")))
+static uint64_t scan_word_sse2(const int32_t* xs, const int32_t* ys,
+                               const int32_t* ws, const int32_t* hs, float cx,
+                               float cy, float r2, uint32_t first)
+{
+    const __m128 vcx = _mm_set1_ps(cx);
+    const __m128 vcy = _mm_set1_ps(cy);
+    const __m128 vr2 = _mm_set1_ps(r2);
+
+    uint64_t hits = 0;
+    for (uint32_t i = 0; i < 64; i += 4) {
+        uint32_t b = first + i;
+        __m128 hit = overlaps4(vcx, vcy, vr2,
+                               _mm_loadu_si128((const __m128i*)(xs + b)),
+                               _mm_loadu_si128((const __m128i*)(ys + b)),
+                               _mm_loadu_si128((const __m128i*)(ws + b)),
+                               _mm_loadu_si128((const __m128i*)(hs + b)));
+        hits |= (uint64_t)_mm_movemask_ps(hit) << i;
+    }
+    return hits;
+}
+#endif /* BLOCKS_X86 */
+
+/* Test the live blocks `bits' of the word starting at block `first'. `full'
+ * tells whether all 64 blocks of the word exist (only then SIMD loads are
+ * safe).
+ */
+static uint64_t scan_word(const int32_t* xs, const int32_t* ys,
+                          const int32_t* ws, const int32_t* hs, float cx,
+                          float cy, float r2, uint32_t first, uint64_t bits,
+                          bool full)
+{
+#ifdef BLOCKS_X86
+    if (full && isa == Isa::AVX2)
+        return scan_word_avx2(xs, ys, ws, hs, cx, cy, r2, first) & bits;
+    if (full && isa == Isa::SSE2)
+        return scan_word_sse2(xs, ys, ws, hs, cx, cy, r2, first) & bits;
+#endif
+    uint64_t hits = 0;
+    for (uint64_t b = bits; b; b &= b - 1) {
+        uint32_t i = first + __builtin_ctzll(b);
+        if (overlaps(cx, cy, r2, xs[i], ys[i], ws[i], hs[i]))
+            hits |= (uint64_t)1 << (i - first);
+    }
+    return hits;
+}
+
+// Only meant for benchmarks, to compare against the plain scalar code.
+void BlockStore::set_vectorized(bool on)
+{
+    isa = on ? best_isa : Isa::SCALAR;
+}
+
+uint32_t BlockStore::add(const SDL_Rect& rect, uint8_t strength)
+{
+    uint32_t index = xs.size();
+    xs.push_back(rect.x);
+    ys.push_back(rect.y);
+    ws.push_back(rect.w);
+    hs.push_back(rect.h);
+    strengths.push_back(strength);
+    if (index / 64 >= alive.size()) alive.push_back(0);
+    alive[index / 64] |= (uint64_t)1 << (index % 64);
+    live++;
+    return index;
+}
+
+void BlockStore::kill(uint32_t index)
+{
+    if (!is_alive(index)) return;
+    alive[index / 64] &= ~((uint64_t)1 << (index % 64));
+    live--;
+}
+
+// Remove all blocks, but keep the memory for the next ones.
+void BlockStore::clear(void)
+{
+    xs.clear();
+    ys.clear();
+    ws.clear();
+    hs.clear();
+    strengths.clear();
+    alive.clear();
+    live = 0;
+}
+
+/* Keep only those of the `n' blocks in `indices' that overlap the circle at
+ * (cx,cy) with radius `r'. The remaining indices are moved to the front (in
+ * their original order) and their number is returned.
+ */
+uint32_t BlockStore::filter_overlapping(float cx, float cy, float r,
+                                        uint32_t* indices, uint32_t n) const
+{
+    const float r2 = r * r;
+#ifdef BLOCKS_X86
+    if (isa == Isa::AVX2)
+        return filter_avx2(xs.data(), ys.data(), ws.data(), hs.data(), cx, cy,
+                           r2, indices, n);
+    if (isa == Isa::SSE2)
+        return filter_sse2(xs.data(), ys.data(), ws.data(), hs.data(), cx, cy,
+                           r2, indices, n);
+#endif
+    uint32_t kept = 0;
+    for (uint32_t i = 0; i < n; i++) {
+        uint32_t b = indices[i];
+        if (overlaps(cx, cy, r2, xs[b], ys[b], ws[b], hs[b]))
+            indices[kept++] = b;
+    }
+    return kept;
+}
+
+/* Brute force: append all live blocks that overlap the circle to `out'. Words
+ * without live blocks are skipped entirely, full words are tested with SIMD.
+ */
+void BlockStore::query(float cx, float cy, float r,
+                       std::vector<uint32_t>& out) const
+{
+    const float    r2   = r * r;
+    const uint32_t full = xs.size() / 64; // words with 64 existing blocks
+    for (uint32_t word = 0; word < alive.size(); word++) {
+        uint64_t bits = alive[word];
+        if (bits == 0) continue;
+
+        uint32_t first = word * 64;
+        uint64_t hits  = scan_word(xs.data(), ys.data(), ws.data(), hs.data(),
+                                   cx, cy, r2, first, bits, word < full);
+        for (; hits; hits &= hits - 1)
+            out.push_back(first + __builtin_ctzll(hits));
+    }
+}
@@ -0,0 +1,105 @@
+#ifndef _BLOCKS_H_
+#define _BLOCKS_H_
+
+#include <cstdint>
+#include <SDL2/SDL_rect.h>
+#include <vector>
+
+/* `BlockStore' keeps all blocks of a level as a structure of arrays, one array
+ * per attribute, plus a bitmask that tells which blocks are still alive.
+ * Destroying a block only clears its bit, nothing is moved, so block indices
+ * stay valid for the lifetime of the store (the spatial index relies on that).
+ * The arrays are laid out such that the circle-vs-block tests can check 4 (SSE)
+ * or 8 (AVX2) blocks at once, the instruction set is picked at runtime.
+ */
+class BlockStore {
+    std::vector<int32_t>  xs, ys, ws, hs;
+    std::vector<uint8_t>  strengths;
+    std::vector<uint64_t> alive;  // bit `i % 64' of word `i / 64'
+    uint32_t              live = 0;
+public:
+    class AliveIterator;
+    struct AliveRange;
+
+    uint32_t add(const SDL_Rect&, uint8_t);
+    void     kill(uint32_t);
+    void     clear(void);
+    uint32_t filter_overlapping(float, float, float, uint32_t*,
+                                uint32_t) const;
+    void     query(float, float, float, std::vector<uint32_t>&) const;
+
+    AliveRange get_alive(void) const;
+
+    static void set_vectorized(bool);
+
+    uint32_t size(void) const                { return xs.size(); }
+    uint32_t count(void) const               { return live; }
+    uint8_t  get_strength(uint32_t i) const  { return strengths[i]; }
+    uint8_t  decrease_strength(uint32_t i)   { return --strengths[i]; }
+    bool     is_alive(uint32_t i) const
+    {
+        return alive[i / 64] >> (i % 64) & 1;
+    }
+    SDL_Rect get_rect(uint32_t i) const
+    {
+        return { xs[i], ys[i], ws[i], hs[i] };
+    }
+};
+
+/* Walks the indices of all live blocks by scanning the bitmask word by word,
+ * so dead blocks cost (almost) nothing:
+ *     for (uint32_t i: store.get_alive()) ...
+ */
+class BlockStore::AliveIterator {
+    const uint64_t* words;
+    uint32_t        num_words;
+    uint32_t        word;    // index of the current word
+    uint64_t        bits;    // bits of the current word not yet visited
+
+    void skip_empty(void)
+    {
+        while (bits == 0) {
+            if (++word >= num_words) {
+                word = num_words;
+                return;
+            }
+            bits = words[word];
+        }
+    }
+public:
+    AliveIterator(const uint64_t* w, uint32_t n, uint32_t start)
+        : words(w), num_words(n), word(start), bits(start < n ? w[start] : 0)
+    {
+        skip_empty();
+    }
+
+    uint32_t operator*(void) const
+    {
+        return word * 64 + __builtin_ctzll(bits);
+    }
+    AliveIterator& operator++(void)
+    {
+        bits &= bits - 1;
+        skip_empty();
+        return *this;
+    }
+    bool operator!=(const AliveIterator& other) const
+    {
+        return word != other.word || bits != other.bits;
+    }
+};
+
+struct BlockStore::AliveRange {
+    const uint64_t* words;
+    uint32_t        num_words;
+
+    AliveIterator begin(void) const { return { words, num_words, 0 }; }
+    AliveIterator end(void) const   { return { words, num_words, num_words }; }
+};
+
+inline BlockStore::AliveRange BlockStore::get_alive(void) const
+{
+    return { alive.data(), (uint32_t)alive.size() };
+}
+
+#endif /* _BLOCKS_H_ */
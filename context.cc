@@ -2,12 +2,15 @@
 #include <SDL2/SDL.h>
 #include <SDL2/SDL_image.h>
 #include <SDL2/SDL_ttf.h>
-#include <thread>
 
 #include "context.hh"
 #include "shapes.hh"
 
-Context::Context(void)
+/* An `offscreen' context renders into a surface with the software renderer
+ * instead of opening a window, and it doesn't open an audio device. That's
+ * meant for benchmarks (see `bench.cc').
+ */
+Context::Context(bool offscreen)
 {
     if (SDL_Init(SDL_INIT_EVERYTHING) != 0) quit_on_error(SDL_GetError());
     if (TTF_Init() != 0)                    quit_on_error(TTF_GetError());
@@ -20,17 +23,25 @@ Context::Context(void)
     bool success = SDL_SetHint(SDL_HINT_VIDEO_X11_NET_WM_PING, "0");
     if (!success) std::cerr << "unable to set hint\n";
 
-    window = SDL_CreateWindow(title, win_x_pos, win_y_pos, win_width,
-                              win_height, SDL_WINDOW_SHOWN);
-    if (!window) quit_on_error(SDL_GetError());
-
-    /* Enabling vsync should limit the framerate to whatever the video card is
-     * capable of. It's still good practice to limit the frame rate in the
-     * game's main loop.
-     * NOTE: Maybe, enabling alpha blending globally is bad?
-     */
-    uint32_t render_flags = SDL_RENDERER_ACCELERATED|SDL_RENDERER_PRESENTVSYNC;
-    renderer = SDL_CreateRenderer(window, -1, render_flags);
+    if (offscreen) {
+        target = SDL_CreateRGBSurfaceWithFormat(0, win_width, win_height, 32,
+                                                SDL_PIXELFORMAT_RGBA32);
+        if (!target) quit_on_error(SDL_GetError());
+        renderer = SDL_CreateSoftwareRenderer(target);
+    } else {
+        window = SDL_CreateWindow(title, win_x_pos, win_y_pos, win_width,
+                                  win_height, SDL_WINDOW_SHOWN);
+        if (!window) quit_on_error(SDL_GetError());
+
+        /* Enabling vsync should limit the framerate to whatever the video
+         * card is capable of. It's still good practice to limit the frame
+         * rate in the game's main loop.
+         */
+        uint32_t render_flags = SDL_RENDERER_ACCELERATED |
+                                SDL_RENDERER_PRESENTVSYNC;
+        renderer = SDL_CreateRenderer(window, -1, render_flags);
+    }
+    // NOTE: Maybe, enabling alpha blending globally is bad?
     if (!renderer) quit_on_error(SDL_GetError());
     SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_BLEND);
 
@@ -38,14 +49,32 @@ Context::Context(void)
     if (!font24) quit_on_error(TTF_GetError());
     font36 = TTF_OpenFont("./assets/fonts/OpenSans-Bold.ttf", 36);
     if (!font36) quit_on_error(TTF_GetError());
+
+    // rasterize all glyphs once, drawing text per frame is just copying quads
+    if (const char* error = glyphs24.build(renderer, font24))
+        quit_on_error(error);
+    if (const char* error = glyphs36.build(renderer, font36))
+        quit_on_error(error);
+    if (const char* error = sprites.build(renderer, "./assets/textures"))
+        quit_on_error(error);
+
+    // the game works without sound, so that's not a reason to quit
+    if (offscreen) return;
+    if (const char* error = mixer.open())
+        std::cerr << "unable to open audio device: " << error << '\n';
 }
 
 Context::~Context(void)
 {
-    for (std::pair<const char*, SDL_Texture*> pair: texture_map)
-        SDL_DestroyTexture(pair.second);
+    textures.clear();
+    glyphs24.release();
+    glyphs36.release();
+    sprites.release();
+    circle_sprites.clear();
+    mixer.close();
     if (window)   SDL_DestroyWindow(window);
     if (renderer) SDL_DestroyRenderer(renderer);
+    if (target)   SDL_FreeSurface(target);
     if (font24)   TTF_CloseFont(font24);
     if (font36)   TTF_CloseFont(font36);
     TTF_Quit();
@@ -61,11 +90,75 @@ void Context::quit_on_error(const char* msg) const
 
 /* Clear the background. Currently, the default color is hard-coded in the
  * header (as a default argument, not a class attribute).
+ * NOTE: All `draw_*()' functions only record commands (see `DrawQueue'), the
+ * renderer doesn't see anything before `render_present()'.
  */
 void Context::clear_renderer(SDL_Color c)
 {
-    SDL_SetRenderDrawColor(renderer, c.r, c.g, c.b, c.a);
-    SDL_RenderClear(renderer);
+    queue.clear(c);
+}
+
+// Submit everything that was drawn in this frame as a few batches and show it.
+void Context::render_present(void)
+{
+    queue.flush(renderer);
+    SDL_RenderPresent(renderer);
+    textures.next_frame();
+}
+
+// Quits on error, like loading any other resource.
+void Context::create_layer(RenderLayer& layer)
+{
+    create_layer(layer, win_width, win_height);
+}
+
+// A layer of its own size, e.g. larger than the window to scroll through.
+void Context::create_layer(RenderLayer& layer, int32_t width, int32_t height)
+{
+    if (const char* error = layer.create(renderer, width, height))
+        quit_on_error(error);
+}
+
+/* Everything drawn until `end_layer()' goes into `layer' instead of the frame
+ * (clipped to its dirty area). Only draw what overlaps `layer.get_dirty()',
+ * the rest is clipped away anyways.
+ */
+void Context::begin_layer(RenderLayer& layer)
+{
+    active = &layer.get_queue();
+}
+
+void Context::end_layer(RenderLayer& layer)
+{
+    active = &queue;
+    if (const char* error = layer.redraw(renderer))
+        std::cerr << "unable to redraw a layer: " << error << '\n';
+}
+
+// Copy the whole layer into the frame, like any other texture.
+void Context::draw_layer(const RenderLayer& layer)
+{
+    if (layer.get_texture())
+        active->texture(layer.get_texture(), nullptr, layer.get_rect());
+}
+
+/* Draw the `src' part of `layer' to `dest'. Parts of `src' outside the layer
+ * are cut, and `dest' shrinks with them (the renderer would reject texture
+ * coordinates outside the texture).
+ */
+void Context::draw_layer(const RenderLayer& layer, const SDL_Rect& src,
+                         const SDL_Rect& dest)
+{
+    const SDL_Rect bounds = layer.get_rect();
+    SDL_Rect       cut;
+    if (!layer.get_texture() || !SDL_IntersectRect(&src, &bounds, &cut))
+        return;
+
+    float    sx = (float)dest.w / src.w, sy = (float)dest.h / src.h;
+    SDL_Rect to = { dest.x + (int32_t)((cut.x - src.x) * sx),
+                    dest.y + (int32_t)((cut.y - src.y) * sy),
+                    (int32_t)(cut.w * sx), (int32_t)(cut.h * sy) };
+    active->texture(layer.get_texture(), &cut, to);
 }
 
 /* Draw an `SDL_Rect' to the screen. The caller must still invoke
@@ -74,160 +167,163 @@ void Context::clear_renderer(SDL_Color c)
 void Context::draw_rectangle(const SDL_Color& color, const SDL_Rect& rect,
                              bool fill)
 {
-    SDL_SetRenderDrawColor(renderer, color.r, color.g, color.b, color.a);
-    if (fill) SDL_RenderFillRect(renderer, &rect);
-    else      SDL_RenderDrawRect(renderer, &rect);
+    if (fill) active->fill_rect(color, rect);
+    else      active->draw_rect(color, rect);
+}
+
+/* Draw an untextured triangle list (e.g. particles) with one renderer call.
+ * The vertices and indices must stay untouched until `render_present()'.
+ */
+void Context::draw_geometry(const SDL_Vertex* vertices, int num_vertices,
+                            const int* indices, int num_indices)
+{
+    active->geometry(vertices, num_vertices, indices, num_indices);
 }
 
 void Context::draw_line(const SDL_Color& color, int32_t x0, int32_t y0,
                         int32_t x1, int32_t y1)
 {
-    SDL_SetRenderDrawColor(renderer, color.r, color.g, color.b, color.a);
-    SDL_RenderDrawLine(renderer, x0, y0, x1, y1);
+    active->line(color, x0, y0, x1, y1);
 }
 
-void Context::draw_circle(const SDL_Color& color, const shapes::Circle& circ)
+/* Circles are drawn from cached sprites (with anti-aliased edges by default),
+ * see `shapes::CircleSprites'. Circles that are too large to be cached become
+ * one filled rectangle per row, which the queue batches into a single call.
+ */
+void Context::draw_circle(const SDL_Color& color, const shapes::Circle& circ,
+                          bool antialias)
 {
-    SDL_SetRenderDrawColor(renderer, color.r, color.g, color.b, color.a);
-    circ.render(renderer);
+    if (circ.get_width() <= shapes::CircleSprites::max_diameter) {
+        SDL_Texture* tex = circle_sprites.get(renderer, circ, color, antialias);
+        if (tex) {
+            active->texture(tex, nullptr, circ.get_bounds());
+            return;
+        }
+    }
+
+    int32_t radius = circ.get_width() / 2;
+    for (int32_t row = -radius; row <= radius; row++)
+        active->fill_rect(color, circ.get_span(row));
 }
 
 /* Copy text to the renderer. The caller must still invoke `render_present()'.
  * The standard font set for this context is used. If x and/or y are ``-1''
  * then the given text will be centered in that direction.
  */
-void Context::draw_text(const std::string& text, const SDL_Color& color,
+void Context::draw_text(std::string_view text, const SDL_Color& color,
                         int32_t x, int32_t y, uint8_t fontsize)
 {
-    SDL_Surface* sf;
-    if (fontsize == 24)
-        sf = TTF_RenderText_Solid(font24, text.c_str(), color);
-    else if (fontsize == 36)
-        sf = TTF_RenderText_Solid(font36, text.c_str(), color);
-    else
-        quit_on_error("invalid font size specified");
-    if (!sf) quit_on_error(TTF_GetError());
-
-    SDL_Texture* tx = SDL_CreateTextureFromSurface(renderer, sf);
-    if (!tx) quit_on_error(SDL_GetError());
-
-    int w, h;
-    if (x == -1 || y == -1)
-        if (TTF_SizeText(get_font(36), text.c_str(), &w, &h))
-            quit_on_error(TTF_GetError());
-
-    SDL_Rect r;
-    if (x == -1) r.x = get_width() / 2 - w / 2;
-    else         r.x = x;
-    if (y == -1) r.y = get_height() / 2 - h / 2;
-    else         r.y = y;
-
-    SDL_QueryTexture(tx, NULL, NULL, &r.w, &r.h);
-    copy_texture_to_renderer(tx, &r);
-    SDL_FreeSurface(sf);
-    SDL_DestroyTexture(tx);
+    TTF_Font* font = get_font(fontsize);
+    if (!font) quit_on_error("invalid font size specified");
+    draw_text(text, color, x, y, font);
 }
 
-void Context::draw_text(const std::string& text, const SDL_Color& color,
+/* Text is drawn from the glyph atlas of the given font, so this doesn't create
+ * any surfaces or textures. Only fonts owned by this context can be used.
+ */
+void Context::draw_text(std::string_view text, const SDL_Color& color,
                         int32_t x, int32_t y, TTF_Font* font)
 {
-    SDL_Surface* sf = TTF_RenderText_Solid(font, text.c_str(), color);
-    if (!sf) quit_on_error(TTF_GetError());
-    SDL_Texture* tx = SDL_CreateTextureFromSurface(renderer, sf);
-    if (!tx) quit_on_error(SDL_GetError());
+    GlyphAtlas& glyphs = get_glyphs(font);
 
-    int w, h;
+    int32_t w, h;
     if (x == -1 || y == -1)
-        if (TTF_SizeText(get_font(36), text.c_str(), &w, &h))
-            quit_on_error(TTF_GetError());
-
-    SDL_Rect r;
-    if (x == -1) r.x = get_width() / 2 - w / 2;
-    else         r.x = x;
-    if (y == -1) r.y = get_height() / 2 - h / 2;
-    else         r.y = y;
-
-    SDL_QueryTexture(tx, NULL, NULL, &r.w, &r.h);
-    copy_texture_to_renderer(tx, &r);
-    SDL_FreeSurface(sf);
-    SDL_DestroyTexture(tx);
+        glyphs.measure(text, &w, &h);
+    if (x == -1) x = get_width() / 2 - w / 2;
+    if (y == -1) y = get_height() / 2 - h / 2;
+
+    glyphs.draw(*active, text, color, x, y);
 }
 
-void Context::draw_texture(const char* path, const SDL_Rect& dest)
+void Context::measure_text(std::string_view text, int32_t* w, int32_t* h,
+                           uint8_t fontsize) const
 {
-    SDL_Texture* tex;
+    TTF_Font* font = get_font(fontsize);
+    if (!font) quit_on_error("invalid font size specified");
+    measure_text(text, w, h, font);
+}
 
-    if (texture_map.find(path) == texture_map.end()) {
-        SDL_Surface* surf = IMG_Load(path);
-        tex = SDL_CreateTextureFromSurface(renderer, surf);
-        SDL_FreeSurface(surf);
-        texture_map[path] = tex;
-    } else {
-        tex = texture_map[path];
-    }
+void Context::measure_text(std::string_view text, int32_t* w, int32_t* h,
+                           TTF_Font* font) const
+{
+    get_glyphs(font).measure(text, w, h);
+}
+
+GlyphAtlas& Context::get_glyphs(TTF_Font* font)
+{
+    if (font == font24)      return glyphs24;
+    else if (font == font36) return glyphs36;
+    quit_on_error("font doesn't belong to this context");
+}
 
-    SDL_Rect r = dest;
-    copy_texture_to_renderer(tex, &r);
+const GlyphAtlas& Context::get_glyphs(TTF_Font* font) const
+{
+    if (font == font24)      return glyphs24;
+    else if (font == font36) return glyphs36;
+    quit_on_error("font doesn't belong to this context");
 }
 
-/* This overload does cropping of the source based on the coordinates supplied
- * via `srcr'. Otherwise, the code is identical to `draw_texture()' above.
- * TODO: instead of just looking up the path in the map, we now need to check
- *       if the texture exists in the correct cropping dimensions.
+/* Textures are loaded when they're registered, so that a missing file is
+ * noticed right away (like a missing font). The returned handle is what's
+ * passed to `draw_texture()'.
  */
-void Context::draw_texture(const char* path, const SDL_Rect& src,
-                           const SDL_Rect& dest)
+TextureCache::Handle Context::load_texture(const char* path)
 {
-    SDL_Texture* tex;
-
-    if (texture_map.find(path) == texture_map.end()) {
-        SDL_Surface* surf = IMG_Load(path);
-        crop_surface(&surf, src.x, src.y, src.w, src.h);
-        tex = SDL_CreateTextureFromSurface(renderer, surf);
-        SDL_FreeSurface(surf);
-        texture_map[path] = tex;
-    } else {
-        tex = texture_map[path];
-    }
+    TextureCache::Handle handle = textures.acquire(path);
+    const char* error = nullptr;
+    if (!textures.get(renderer, handle, &error)) quit_on_error(error);
+    return handle;
+}
+
+// Same as above, but only the part of the image inside `crop' is kept.
+TextureCache::Handle Context::load_texture(const char* path,
+                                           const SDL_Rect& crop)
+{
+    TextureCache::Handle handle = textures.acquire(path, &crop);
+    const char* error = nullptr;
+    if (!textures.get(renderer, handle, &error)) quit_on_error(error);
+    return handle;
+}
+
+/* Sprites are looked up by name once (e.g. when the game starts), drawing
+ * them with `draw_sprite()' is cheap. A missing image is an error.
+ */
+Sprite Context::get_sprite(const std::string& name) const
+{
+    Sprite sprite = sprites.get(name);
+    if (sprite.src.w == 0) quit_on_error(("no sprite " + name).c_str());
+    return sprite;
+}
 
-    SDL_Rect r = dest;
-    copy_texture_to_renderer(tex, &r);
+Sprite Context::get_sprite(const std::string& name, const SDL_Rect& crop) const
+{
+    Sprite sprite = sprites.get(name, crop);
+    if (sprite.src.w == 0) quit_on_error(("no sprite " + name).c_str());
+    return sprite;
 }
 
-void Context::crop_surface(SDL_Surface** surface, uint32_t x, uint32_t y,
-                           uint32_t width, uint32_t height)
+/* If the texture was evicted from the cache in the meantime, it's loaded
+ * again. Should that fail, the error is reported and nothing is drawn.
+ */
+void Context::draw_texture(TextureCache::Handle handle, const SDL_Rect& dest)
 {
-    uint32_t rm, gm, bm, am;
-    #if SDL_BYTEORDER == SDL_BIG_ENDIAN
-        rm = 0xff000000; gm = 0x00ff0000; bm = 0x0000ff00; am = 0x000000ff;
-    #else
-        rm = 0x000000ff; gm = 0x0000ff00; bm = 0x00ff0000; am = 0xff000000;
-    #endif
-
-    SDL_Surface* cropped_surf = SDL_CreateRGBSurface(0, width, height, 32,
-                                                     rm, gm, bm, am);
-    if (cropped_surf == NULL)
-        quit_on_error(SDL_GetError());
-
-    SDL_Rect r;
-    r.x = x;
-    r.y = y;
-    r.w = width;
-    r.h = height;
-    if (SDL_BlitSurface(*surface, &r, cropped_surf, NULL) != 0)
-        quit_on_error(SDL_GetError());
-
-    SDL_FreeSurface(*surface);
-    *surface = cropped_surf;
+    const char*  error = nullptr;
+    SDL_Texture* tex   = textures.get(renderer, handle, &error);
+    if (!tex) {
+        std::cerr << "unable to load texture: " << error << '\n';
+        return;
+    }
+    copy_texture_to_renderer(tex, dest);
 }
 
 /* Copy a texture to the renderer. The caller must still invoke
  * `render_present()'. We use this function for better naming and convenience,
  * since we usually don't specify any copy flags.
  */
-void Context::copy_texture_to_renderer(SDL_Texture* texture, SDL_Rect* dest)
+void Context::copy_texture_to_renderer(SDL_Texture* texture,
+                                       const SDL_Rect& dest)
 {
-    SDL_RenderCopy(renderer, texture, NULL, dest);
+    active->texture(texture, nullptr, dest);
 }
 
 
@@ -238,29 +334,20 @@ TTF_Font* Context::get_font(uint8_t fontsize) const
     return nullptr;
 }
 
-void Context::play_audio(const char* audio_path)
+/* Sounds have to be loaded before they can be played, which is best done
+ * before the game starts (loading means reading and converting the file).
+ * The returned sound is what's passed to `play_audio()'.
+ */
+Mixer::Sound Context::load_audio(const char* audio_path)
 {
-    auto fn = [&, audio_path](void) -> void {
-        SDL_AudioSpec wav_spec;
-        uint32_t      wav_length;
-        uint8_t*      wav_buffer;
-
-        if (SDL_LoadWAV(audio_path, &wav_spec,
-                        &wav_buffer, &wav_length) == NULL) {
-            std::cerr << "error: unable to load .wav file\n";
-            quit_on_error(SDL_GetError());
-        }
+    Mixer::Sound sound = 0;
+    if (const char* error = mixer.load(audio_path, &sound))
+        quit_on_error(error);
+    return sound;
+}
 
-        SDL_AudioDeviceID device_id = SDL_OpenAudioDevice(NULL, 0, &wav_spec,
-                                                          NULL, 0);
-        SDL_QueueAudio(device_id, wav_buffer, wav_length);
-        SDL_PauseAudioDevice(device_id, 0);
-
-        SDL_Delay(3000);   // just a heuristic, no idea how to determine the
-                           // length of the sound
-        SDL_CloseAudioDevice(device_id);
-        SDL_FreeWAV(wav_buffer);
-    };
-    std::thread audio_thread(fn);
-    audio_thread.detach(); // don't block the game
+// Only queues the sound for the audio thread, this doesn't block.
+void Context::play_audio(Mixer::Sound sound)
+{
+    if (!mixer.play(sound)) std::cerr << "unable to play a sound\n";
 }
@@ -5,40 +5,79 @@
 #include <SDL2/SDL.h>
 #include <SDL2/SDL_ttf.h>
 #include <string>
-#include <unordered_map>
+#include <string_view>
 
+#include "audio.hh"
+#include "draw.hh"
+#include "glyphs.hh"
+#include "layer.hh"
 #include "shapes.hh"
+#include "sprites.hh"
+#include "textures.hh"
 
 class Context {
     SDL_Window*    window     = nullptr;
+    SDL_Surface*   target     = nullptr; // instead of `window' if offscreen
     SDL_Renderer*  renderer   = nullptr;
     TTF_Font*      font24     = nullptr;
     TTF_Font*      font36     = nullptr;
+    GlyphAtlas     glyphs24;
+    GlyphAtlas     glyphs36;
+
+    shapes::CircleSprites circle_sprites;
+    SpriteAtlas    sprites; // everything in `./assets/textures'
+    Mixer          mixer;
     const char*    title      = "Breakout";
     const uint32_t win_x_pos  = SDL_WINDOWPOS_CENTERED;
     const uint32_t win_y_pos  = SDL_WINDOWPOS_CENTERED;
     const uint32_t win_width  = 910;
     const uint32_t win_height = 720;
 
-    std::unordered_map<const char*, SDL_Texture*> texture_map;
+    TextureCache   textures { 256 * 1024 * 1024 }; // budget in bytes
+    DrawQueue      queue; // everything drawn in the current frame
+    DrawQueue*     active = &queue; // or the queue of the layer being redrawn
 
-    void copy_texture_to_renderer(SDL_Texture*, SDL_Rect*);
-    void crop_surface(SDL_Surface**, uint32_t, uint32_t, uint32_t, uint32_t);
+    void copy_texture_to_renderer(SDL_Texture*, const SDL_Rect&);
+    GlyphAtlas& get_glyphs(TTF_Font*);
+    const GlyphAtlas& get_glyphs(TTF_Font*) const;
 public:
-    Context(void);
+    explicit Context(bool = false);
     ~Context(void);
 
     void draw_line(const SDL_Color&, int32_t, int32_t, int32_t, int32_t);
     void draw_rectangle(const SDL_Color&, const SDL_Rect&, bool = true);
-    void draw_circle(const SDL_Color&, const shapes::Circle&);
-    void draw_texture(const char*, const SDL_Rect&);
-    void draw_texture(const char*, const SDL_Rect&, const SDL_Rect&);
-    void draw_text(const std::string&, const SDL_Color&, int32_t, int32_t,
+    void draw_circle(const SDL_Color&, const shapes::Circle&, bool = true);
+    void draw_geometry(const SDL_Vertex*, int, const int*, int);
+    TextureCache::Handle load_texture(const char*);
+    TextureCache::Handle load_texture(const char*, const SDL_Rect&);
+    void draw_texture(TextureCache::Handle, const SDL_Rect&);
+    Sprite get_sprite(const std::string&) const;
+    Sprite get_sprite(const std::string&, const SDL_Rect&) const;
+    void draw_sprite(const Sprite& sprite, const SDL_Rect& dest)
+    {
+        sprites.draw(*active, sprite, dest);
+    }
+    void set_texture_budget(uint64_t bytes) { textures.set_budget(bytes); }
+    void draw_text(std::string_view, const SDL_Color&, int32_t, int32_t,
                    uint8_t = 24);
-    void draw_text(const std::string&, const SDL_Color&, int32_t, int32_t,
+    void draw_text(std::string_view, const SDL_Color&, int32_t, int32_t,
                    TTF_Font*);
-    void play_audio(const char*);
+    void measure_text(std::string_view, int32_t*, int32_t*,
+                      uint8_t = 24) const;
+    void measure_text(std::string_view, int32_t*, int32_t*,
+                      TTF_Font*) const;
+    Mixer::Sound load_audio(const char*);
+    void play_audio(Mixer::Sound);
     void clear_renderer(SDL_Color = { 180, 180, 180, 255 });
+    void next_layer(void) { active->next_layer(); }
+    void create_layer(RenderLayer&);
+    void create_layer(RenderLayer&, int32_t, int32_t);
+    void begin_layer(RenderLayer&);
+    void end_layer(RenderLayer&);
+    void draw_layer(const RenderLayer&);
+    void draw_layer(const RenderLayer&, const SDL_Rect&, const SDL_Rect&);
+    void render_present(void);
+    void discard_frame(void) { queue.discard(); }
     TTF_Font* get_font(uint8_t = 24) const;
 
     [[noreturn]] void quit_on_error(const char*) const;
@@ -47,7 +86,10 @@ public:
     constexpr uint32_t get_height(void) const { return win_height; }
     constexpr uint32_t get_width(void) const  { return win_width; }
 
-    void          render_present(void)     { SDL_RenderPresent(renderer); }
+    const DrawQueue::Stats& get_frame_stats(void) const
+    {
+        return queue.get_stats();
+    }
     SDL_Window*   get_window(void) const   { return window; }
     SDL_Renderer* get_renderer(void) const { return renderer; }
 };
@@ -0,0 +1,228 @@
+#include <algorithm>
+#include <functional>
+#include <SDL2/SDL.h>
+
+#include "draw.hh"
+
+static uint32_t pack_color(const SDL_Color& c)
+{
+    return (uint32_t)c.r << 24 | (uint32_t)c.g << 16 |
+           (uint32_t)c.b << 8  | (uint32_t)c.a;
+}
+
+/* Clearing throws away everything that was recorded so far in this frame,
+ * it would be painted over anyways.
+ */
+void DrawQueue::clear(const SDL_Color& color)
+{
+    commands.clear();
+    geometries.clear();
+    layer = 0;
+    clear_requested = true;
+    clear_color = color;
+}
+
+void DrawQueue::next_layer(void)
+{
+    layer++;
+}
+
+void DrawQueue::push(Kind kind, SDL_Texture* texture, const SDL_Color& color,
+                     const SDL_Rect& src, const SDL_Rect& dest)
+{
+    uint32_t seq = commands.size();
+    commands.push_back({ layer, kind, seq, texture, color, src, dest });
+}
+
+void DrawQueue::fill_rect(const SDL_Color& color, const SDL_Rect& rect)
+{
+    push(Kind::FILL_RECT, nullptr, color, { 0, 0, 0, 0 }, rect);
+}
+
+void DrawQueue::draw_rect(const SDL_Color& color, const SDL_Rect& rect)
+{
+    push(Kind::DRAW_RECT, nullptr, color, { 0, 0, 0, 0 }, rect);
+}
+
+void DrawQueue::line(const SDL_Color& color, int32_t x0, int32_t y0,
+                     int32_t x1, int32_t y1)
+{
+    push(Kind::LINE, nullptr, color, { x0, y0, 0, 0 }, { x1, y1, 0, 0 });
+}
+
+/* Queue a copy of `texture' (or the `src' part of it, if given) to `dest'. The
+ * texture must stay alive until the queue is flushed.
+ */
+void DrawQueue::texture(SDL_Texture* texture, const SDL_Rect* src,
+                        const SDL_Rect& dest, const SDL_Color& color)
+{
+    push(Kind::TEXTURE, texture, color, src ? *src : SDL_Rect{ 0, 0, 0, 0 },
+         dest);
+}
+
+/* Queue a triangle list as it is, e.g. all particles of a frame. Nothing is
+ * copied, so the vertices and indices must stay untouched until the queue is
+ * flushed.
+ */
+void DrawQueue::geometry(const SDL_Vertex* vertices, int num_vertices,
+                         const int* indices, int num_indices)
+{
+    if (num_indices == 0) return;
+    SDL_Rect index = { (int32_t)geometries.size(), 0, 0, 0 };
+    geometries.push_back({ vertices, num_vertices, indices, num_indices });
+    push(Kind::GEOMETRY, nullptr, { 0, 0, 0, 0 }, index, { 0, 0, 0, 0 });
+}
+
+void DrawQueue::set_color(SDL_Renderer* renderer, const SDL_Color& c)
+{
+    if (current_color_valid && pack_color(current_color) == pack_color(c))
+        return;
+    SDL_SetRenderDrawColor(renderer, c.r, c.g, c.b, c.a);
+    current_color = c;
+    current_color_valid = true;
+    stats.state_changes++;
+}
+
+/* Submit all recorded commands and reset the queue for the next frame. The
+ * caller still has to present the renderer.
+ */
+void DrawQueue::flush(SDL_Renderer* renderer)
+{
+    stats = Stats();
+    stats.commands = commands.size();
+    current_color_valid = false; // somebody else might have changed it
+
+    if (clear_requested) {
+        set_color(renderer, clear_color);
+        SDL_RenderClear(renderer);
+        stats.draw_calls++;
+        clear_requested = false;
+    }
+
+    std::sort(commands.begin(), commands.end(),
+              [](const Command& a, const Command& b) {
+        if (a.layer != b.layer)     return a.layer < b.layer;
+        if (a.kind != b.kind)       return a.kind < b.kind;
+        if (a.texture != b.texture)
+            return std::less<SDL_Texture*>()(a.texture, b.texture);
+        // textures are tinted per vertex, so color doesn't split a batch
+        if (a.kind != Kind::TEXTURE &&
+            pack_color(a.color) != pack_color(b.color))
+            return pack_color(a.color) < pack_color(b.color);
+        return a.seq < b.seq;
+    });
+
+    size_t i = 0;
+    while (i < commands.size()) {
+        switch (commands[i].kind) {
+        case Kind::FILL_RECT:
+        case Kind::DRAW_RECT: i = flush_rects(renderer, i);    break;
+        case Kind::LINE:      i = flush_lines(renderer, i);    break;
+        case Kind::TEXTURE:   i = flush_textures(renderer, i); break;
+        case Kind::GEOMETRY:  i = flush_geometry(renderer, i); break;
+        }
+    }
+
+    commands.clear();
+    geometries.clear();
+    layer = 0;
+}
+
+// Forget everything recorded since the last flush without drawing it.
+void DrawQueue::discard(void)
+{
+    commands.clear();
+    geometries.clear();
+    layer = 0;
+    clear_requested = false;
+}
+
+/* Draw the run of rectangles starting at `first' that share layer, kind and
+ * color with a single call. Returns the index of the next command.
+ */
+size_t DrawQueue::flush_rects(SDL_Renderer* renderer, size_t first)
+{
+    const Command& head = commands[first];
+    size_t last = first;
+    rects.clear();
+    while (last < commands.size() && commands[last].layer == head.layer &&
+           commands[last].kind == head.kind &&
+           pack_color(commands[last].color) == pack_color(head.color))
+        rects.push_back(commands[last++].dest);
+
+    set_color(renderer, head.color);
+    if (head.kind == Kind::FILL_RECT)
+        SDL_RenderFillRects(renderer, rects.data(), rects.size());
+    else
+        SDL_RenderDrawRects(renderer, rects.data(), rects.size());
+    stats.draw_calls++;
+    return last;
+}
+
+/* Lines aren't connected, so `SDL_RenderDrawLines()' can't be used. We still
+ * save the color changes, though.
+ */
+size_t DrawQueue::flush_lines(SDL_Renderer* renderer, size_t first)
+{
+    const Command& head = commands[first];
+    size_t last = first;
+    set_color(renderer, head.color);
+    while (last < commands.size() && commands[last].layer == head.layer &&
+           commands[last].kind == Kind::LINE &&
+           pack_color(commands[last].color) == pack_color(head.color)) {
+        const Command& c = commands[last++];
+        SDL_RenderDrawLine(renderer, c.src.x, c.src.y, c.dest.x, c.dest.y);
+        stats.draw_calls++;
+    }
+    return last;
+}
+
+/* All quads of one texture in the same layer become one indexed triangle list.
+ * The color of a command becomes the vertex color, which SDL multiplies with
+ * the texture (like `SDL_SetTextureColorMod()' would).
+ */
+size_t DrawQueue::flush_textures(SDL_Renderer* renderer, size_t first)
+{
+    const Command& head = commands[first];
+    int tw, th;
+    if (SDL_QueryTexture(head.texture, NULL, NULL, &tw, &th) != 0) tw = th = 1;
+
+    size_t last = first;
+    vertices.clear();
+    indices.clear();
+    while (last < commands.size() && commands[last].layer == head.layer &&
+           commands[last].kind == Kind::TEXTURE &&
+           commands[last].texture == head.texture) {
+        const Command& c = commands[last++];
+        SDL_Rect src = c.src.w ? c.src : SDL_Rect{ 0, 0, tw, th };
+
+        float x0 = c.dest.x,                y0 = c.dest.y;
+        float x1 = c.dest.x + c.dest.w,     y1 = c.dest.y + c.dest.h;
+        float u0 = (float)src.x / tw,       v0 = (float)src.y / th;
+        float u1 = (float)(src.x + src.w) / tw;
+        float v1 = (float)(src.y + src.h) / th;
+
+        int base = vertices.size();
+        vertices.push_back({ { x0, y0 }, c.color, { u0, v0 } });
+        vertices.push_back({ { x1, y0 }, c.color, { u1, v0 } });
+        vertices.push_back({ { x1, y1 }, c.color, { u1, v1 } });
+        vertices.push_back({ { x0, y1 }, c.color, { u0, v1 } });
+        for (int i: { 0, 1, 2, 0, 2, 3 }) indices.push_back(base + i);
+    }
+
+    SDL_RenderGeometry(renderer, head.texture, vertices.data(),
+                       vertices.size(), indices.data(), indices.size());
+    stats.draw_calls++;
+    stats.state_changes++; // every batch binds a different texture
+    return last;
+}
+
+// Geometry is already batched by the caller, so it's one call per command.
+size_t DrawQueue::flush_geometry(SDL_Renderer* renderer, size_t first)
+{
+    const Geometry& g = geometries[commands[first].src.x];
+    SDL_RenderGeometry(renderer, nullptr, g.vertices, g.num_vertices,
+                       g.indices, g.num_indices);
+    stats.draw_calls++;
+    return first + 1;
+}
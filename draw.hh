@@ -0,0 +1,91 @@
+#ifndef _DRAW_H_
+#define _DRAW_H_
+
+#include <cstdint>
+#include <SDL2/SDL.h>
+#include <vector>
+
+/* A `DrawQueue' records everything that is drawn during a frame and submits it
+ * in as few renderer calls as possible when the frame is flushed: commands are
+ * sorted by layer, kind, texture and color, consecutive rectangles of the same
+ * color become one `SDL_RenderFillRects()'/`SDL_RenderDrawRects()' call and
+ * all quads that use the same texture become one `SDL_RenderGeometry()' call.
+ *
+ * Prebuilt triangle lists (see `geometry()') are submitted as they are, one
+ * call each.
+ *
+ * Sorting changes the drawing order, so within a layer, filled rectangles are
+ * drawn first, then outlines, lines, textures and finally geometry. Draws of
+ * the same kind are ordered by texture and color, not by when they were made:
+ * only those that share a texture (or color) keep their relative order, and
+ * a fill can end up below a backdrop of another color that was drawn before
+ * it. So draws that overlap, like a background and whatever is on it, must go
+ * into separate layers: call `next_layer()' in between.
+ */
+class DrawQueue {
+public:
+    struct Stats {
+        uint32_t commands      = 0; // draws requested by the game
+        uint32_t draw_calls    = 0; // calls into the renderer
+        uint32_t state_changes = 0; // draw color and texture switches
+    };
+private:
+    enum class Kind : uint8_t { FILL_RECT, DRAW_RECT, LINE, TEXTURE, GEOMETRY };
+
+    struct Command {
+        uint16_t     layer;
+        Kind         kind;
+        uint32_t     seq;     // submission order, keeps the sort stable
+        SDL_Texture* texture; // only for `TEXTURE'
+        SDL_Color    color;   // draw color or color modulation for textures
+        SDL_Rect     src;     // texture source (w == 0: all), line (x0,y0),
+                              // or index into `geometries'
+        SDL_Rect     dest;    // rectangle or texture destination, line (x1,y1)
+    };
+
+    // vertices and indices of a triangle list, owned by the caller
+    struct Geometry {
+        const SDL_Vertex* vertices;
+        int               num_vertices;
+        const int*        indices;
+        int               num_indices;
+    };
+
+    std::vector<Command>  commands;
+    std::vector<Geometry> geometries;
+    uint16_t              layer = 0;
+    bool                  clear_requested = false;
+    SDL_Color             clear_color = { 0, 0, 0, 255 };
+
+    // scratch buffers for `flush()', reused every frame
+    std::vector<SDL_Rect>   rects;
+    std::vector<SDL_Vertex> vertices;
+    std::vector<int>        indices;
+
+    SDL_Color current_color = { 0, 0, 0, 0 };
+    bool      current_color_valid = false;
+    Stats     stats;
+
+    void push(Kind, SDL_Texture*, const SDL_Color&, const SDL_Rect&,
+              const SDL_Rect&);
+    void set_color(SDL_Renderer*, const SDL_Color&);
+    size_t flush_rects(SDL_Renderer*, size_t);
+    size_t flush_lines(SDL_Renderer*, size_t);
+    size_t flush_textures(SDL_Renderer*, size_t);
+    size_t flush_geometry(SDL_Renderer*, size_t);
+public:
+    void clear(const SDL_Color&);
+    void fill_rect(const SDL_Color&, const SDL_Rect&);
+    void draw_rect(const SDL_Color&, const SDL_Rect&);
+    void line(const SDL_Color&, int32_t, int32_t, int32_t, int32_t);
+    void texture(SDL_Texture*, const SDL_Rect*, const SDL_Rect&,
+                 const SDL_Color& = { 255, 255, 255, 255 });
+    void geometry(const SDL_Vertex*, int, const int*, int);
+    void next_layer(void);
+    void flush(SDL_Renderer*);
+    void discard(void);
+
+    const Stats& get_stats(void) const { return stats; }
+};
+
+#endif /* _DRAW_H_ */
@@ -1,367 +1,389 @@
-#include <cassert>
-#include <cstdio>
+#include <algorithm>
+#include <ctime>
 #include <iostream>
 #include <SDL2/SDL.h>
 #include <SDL2/SDL_image.h>
 #include <SDL2/SDL_ttf.h>
+#include <string_view>
+#include <utility>
 
 #include "context.hh"
 #include "game.hh"
 #include "ui.hh"
 
-template <typename T>
-static constexpr const T& min(const T& a, const T& b)
-{
-    return (a <= b) ? a : b;
-}
-
-template <typename T>
-static constexpr const T& max(const T& a, const T& b)
-{
-    return (a >= b) ? a : b;
-}
-
 static const SDL_Color blue  = { 37, 26, 239, 255 };
 static const SDL_Color red   = { 170, 10, 20, 255 };
 static const SDL_Color green = { 15, 222, 47, 255 };
 static const SDL_Color black = { 15, 15, 15, 255 };
+static const SDL_Color shade = { 255, 255, 255, 160 };
 
-static const Player default_player = { 40, 650, 150, 20 };
+// what flies off a brick that's hit, or broken
+static const ParticlePool::Spray sparks = { { 255, 220, 90, 255 }, 500.0f,
+                                            0.4f, 4.0f };
+static const ParticlePool::Spray debris = { { 190, 80, 40, 255 }, 300.0f,
+                                            0.9f, 8.0f };
 
-static const int32_t wball = 35;
-static const int32_t xball = default_player.get_xpos() +
-                             default_player.get_width()/2;
-static const int32_t yball = default_player.get_ypos() - wball/2 - 5;
-static const Ball default_ball = { xball, yball, wball };
+static const char* lose_sound = "./assets/sounds/lose_sound.wav";
+static const SDL_Rect brick_crop = { 100, 100, 100, 100 };
 
-Game::Game(bool draw_fps)
-    : player(default_player), ball(default_ball), draw_fps(draw_fps)
+/* Play the default level, or the one in `map' (which must be as wide as the
+ * window, it's only scrolled vertically). An `offscreen' game draws into a
+ * surface instead of a window (for tests).
+ */
+Game::Game(bool draw_fps, uint32_t tick_rate, const level::Map* map,
+           bool offscreen)
+    : context(offscreen),
+      session(context.get_width(), context.get_height(), tick_rate, input,
+              map),
+      tick_rate(tick_rate), draw_fps(draw_fps)
 {
-    const uint32_t block_width  = 80;
-    const uint32_t block_height = 40;
-    const uint32_t xmargin      = 10;
-    const uint32_t ymargin      = 5;
-    const uint32_t num_blocks_x = (context.get_width()-xmargin) / block_width;
-    const uint32_t num_blocks_y = 4;
-
-    for (uint32_t x = 0; x < num_blocks_x; x++)
-        for (uint32_t y = 0; y < num_blocks_y; y++) {
-            blocks.emplace_back(Block(
-                    x*block_width + (x+1)*xmargin,
-                    y*block_height + (y+1)*ymargin,
-                    block_width,
-                    block_height,
-                    num_blocks_y - y
-                    ));
-        }
+    pending.reserve(1024); // as many as the session's queue holds
+
+    if (session.get_width() != (int32_t)context.get_width())
+        context.quit_on_error("the level isn't as wide as the window");
+
+    lose  = context.load_audio(lose_sound);
+    brick = context.get_sprite("brick", brick_crop);
+    context.create_layer(bricks, session.get_width(),
+                         session.get_band_height());
+    context.create_layer(screen);
+    take_blocks(session.get_snapshot());
 
     // NOTE: the font needs to live as long as the button
-    ui::Button button(10, 10, 250, 80);
-    button.add_text("Hello Coco", context.get_font());
-    button.add_callback([&](void*) { state = GameState::HIGHSCORE; }, nullptr);
-    ui_buttons.emplace_back(button);
+    const SDL_Rect& r = Session::highscore_button; // the session handles it
+    ui::Button button(r.x, r.y, r.w, r.h);
+    button.add_text("Hello Coco", context.get_font(), context);
+    ui_buttons.emplace_back(std::move(button));
 }
 
+/* Draw the latest snapshot. The moving objects are interpolated between its
+ * tick and the one before, by how much of a tick has passed since. The view
+ * scrolls with the ball through levels higher than the window.
+ * While playing, this must not allocate: text is formatted into `arena'.
+ */
 void Game::render(void)
 {
-    if (state == GameState::PAUSED) {
-        return;
-    } else if (state == GameState::PLAYING) {
+    const Snapshot& snapshot = session.get_snapshot();
+    const GameState state    = snapshot.state;
+
+    uint64_t count = alloc::get_count(); // all threads, since the last render
+    frame_allocations = count - allocations;
+    allocations       = count;
+    arena.reset();
+
+    profiler.begin(Profiler::Phase::RENDER);
+    if (state == GameState::PLAYING || state == GameState::PAUSED) {
+        // frozen at the tick while paused
+        float alpha = state == GameState::PAUSED ? 1.0f : get_alpha(snapshot);
+        int32_t camera = get_camera(snapshot, alpha);
+        int32_t w = context.get_width(), h = context.get_height();
         context.clear_renderer();
 
-        for (const Block& block: blocks) {
-            SDL_Rect crop = { 100, 100, 100, 100 };
-            context.draw_texture("./assets/textures/brick.png", crop,
-                                 block.get_rect());
+        if (bricks.is_dirty()) draw_bricks();
+        context.draw_layer(bricks, { 0, camera - bricks_band.y, w, h },
+                           { 0, 0, w, h });
+        context.next_layer(); // particles on top of the bricks
+        uint32_t num_indices = particles.build(camera);
+        context.draw_geometry(particles.get_vertices(),
+                              particles.get_count() * 4,
+                              particles.get_indices(), num_indices);
+        context.next_layer(); // paddle and balls on top of those
+        SDL_Rect paddle = snapshot.player.get_rect(alpha);
+        paddle.y -= camera;
+        context.draw_rectangle(blue, paddle);
+        for (const Ball& b: snapshot.balls) {
+            shapes::Circle ball = b.get_circle(alpha);
+            ball.update_y(-camera);
+            context.draw_circle(black, ball);
         }
-        context.draw_rectangle(blue, player.get_rect());
-        context.draw_circle(black, ball.get_circle());
 
-        std::string msg = "Score: " + std::to_string(score);
+        std::string_view msg = arena.format("Score: %u", snapshot.score);
         context.draw_text(msg, black, 10, context.get_height()-50);
         if (draw_fps) {
-            std::string msg = "FPS: " + std::to_string(current_fps);
+            msg = arena.format("FPS: %u", current_fps);
             context.draw_text(msg, black, context.get_width()-130,
                               context.get_height()-50);
+
+            // renderer calls and state changes of the previous frame
+            const DrawQueue::Stats& stats = context.get_frame_stats();
+            msg = arena.format("Calls: %u States: %u", stats.draw_calls,
+                               stats.state_changes);
+            context.draw_text(msg, black, context.get_width()-260,
+                              context.get_height()-80);
+            if (alloc::tracking) {
+                msg = arena.format("Allocs: %llu",
+                                   (unsigned long long)frame_allocations);
+                context.draw_text(msg, black, context.get_width()-260,
+                                  context.get_height()-110);
+            }
+            draw_profile();
+        }
+        if (state == GameState::PAUSED) {
+            msg = "The game is paused!";
+            int32_t w, h;
+            context.measure_text(msg, &w, &h);
+            context.next_layer();
+            context.draw_text(msg, black, context.get_width() / 2 - w / 2,
+                              context.get_height() / 2 - h / 2);
+        }
+    } else {
+        // the menus and end screens only change with the state
+        if (state != screen_state) {
+            screen.invalidate();
+            screen_state = state;
         }
-    } else if (state == GameState::START) {
-        context.clear_renderer(blue);
-        std::string msg = "Press SPACE to start!";
-        int w, h;
-        if (TTF_SizeText(context.get_font(36), msg.c_str(), &w, &h))
-            context.quit_on_error(TTF_GetError());
+        if (screen.is_dirty()) {
+            context.begin_layer(screen);
+            draw_screen(snapshot);
+            context.end_layer(screen);
+        }
+        context.draw_layer(screen); // opaque, no need to clear the frame
+    }
+    profiler.end(Profiler::Phase::RENDER);
+
+    profiler.begin(Profiler::Phase::PRESENT);
+    context.render_present();
+    profiler.end(Profiler::Phase::PRESENT);
+}
+
+/* Compose the screen of a state other than PLAYING (and PAUSED). It goes into
+ * the `screen' layer, so this only runs once the state changes.
+ */
+void Game::draw_screen(const Snapshot& snapshot)
+{
+    const GameState state = snapshot.state;
+    SDL_Rect        all   = screen.get_rect();
+    if (state == GameState::START) {
+        context.draw_rectangle(blue, all);
+        context.next_layer(); // the buttons on top of the background
+        std::string_view msg = "Press SPACE to start!";
+        int32_t w, h;
+        context.measure_text(msg, &w, &h, 36);
         context.draw_text(msg, black, context.get_width() / 2 - w / 2,
                           context.get_height() / 2 - h / 2, 36);
         msg = "BREAKOUT";
-        if (TTF_SizeText(context.get_font(36), msg.c_str(), &w, &h))
-            context.quit_on_error(TTF_GetError());
+        context.measure_text(msg, &w, &h, 36);
         context.draw_text(msg, black, context.get_width() / 2 - w / 2,
                           context.get_height() / 2 - 150, 36);
 
         for (ui::Button& button: ui_buttons)
             button.render(context, -1, -1);
     } else if (state == GameState::HIGHSCORE) {
-        context.clear_renderer(blue);
-        std::string msg = "HIGHSCORES";
-        context.draw_text(msg, black, -1, -1, 36);
+        context.draw_rectangle(blue, all);
+        context.next_layer();
+        std::string_view msg = "HIGHSCORES";
+        int32_t w, h;
+        context.measure_text(msg, &w, &h, 36);
+        context.draw_text(msg, black, context.get_width() / 2 - w / 2, 40, 36);
+        draw_scores();
     } else if (state == GameState::LOST) {
-        context.clear_renderer(red);
-        std::string msg = "You lost!";
+        context.draw_rectangle(red, all);
+        context.next_layer();
+        std::string_view msg = "You lost!";
         context.draw_text(msg, black, -1, -1, 36);
     } else if (state == GameState::WON) {
-        context.clear_renderer(green);
-        std::string msg = "You won!";
+        context.draw_rectangle(green, all);
+        context.next_layer();
+        std::string_view msg = "You won!";
         context.draw_text(msg, black, -1, -1, 36);
     }
-
-    context.render_present();
 }
 
-void Game::key_press(void)
+// The best games (as many as fit), with the date they were played on.
+void Game::draw_scores(void)
 {
-    if (state == GameState::START) {
-        state = GameState::PLAYING;
-    } else if (state == GameState::LOST) {
-        context.quit_on_success(0);
+    const std::vector<scores::Entry>& top = scores.get_top();
+    const int32_t x = context.get_width() / 2 - 150;
+    if (top.empty()) {
+        context.draw_text("No games played yet", black, -1, -1);
+        return;
     }
-}
 
-void Game::left_button_press(int32_t x, int32_t y)
-{
-    if (state == GameState::START) {
-        /* Render the pressed button for 200ms, minimally delaying the game.
-         * Here, we rely on the fact that just one button can be clicked at a
-         * time.
-         */
-        for (ui::Button& button: ui_buttons) {
-            bool selected = button.render(context, x, y, true);
-            if (selected) {
-                context.render_present();
-                SDL_Delay(150);
-            }
-        }
+    uint32_t rows = std::min<size_t>(top.size(), 12);
+    for (uint32_t i = 0; i < rows; i++) {
+        time_t    played = top[i].time;
+        struct tm date;
+        localtime_r(&played, &date);
+        context.draw_text(arena.format("%2u.  %7u   %04d-%02d-%02d", i + 1,
+                                       top[i].score, date.tm_year + 1900,
+                                       date.tm_mon + 1, date.tm_mday),
+                          black, x, 120 + i * 40);
     }
+    context.draw_text(arena.format("%llu games played",
+                                   (unsigned long long)scores.get_games()),
+                      black, x, context.get_height() - 80);
 }
 
-void Game::toggle_pause(void)
+/* Redraw the part of the brick layer that changed since the last frame, only
+ * the bricks overlapping it are drawn. The layer holds the band of the level
+ * the simulation has loaded, its top is at `bricks_band.y'.
+ */
+void Game::draw_bricks(void)
 {
-    // pausing doesn't do much for most game states
-    if (state == GameState::PLAYING)     state = GameState::PAUSED;
-    else if (state == GameState::PAUSED) state = GameState::PLAYING;
-
-    // render this message once when entering the pausing state
-    if (state == GameState::PAUSED) {
-        std::string msg = "The game is paused!";
-        int w, h;
-        if (TTF_SizeText(context.get_font(), msg.c_str(), &w, &h))
-            context.quit_on_error(TTF_GetError());
-        context.draw_text(msg, black, context.get_width() / 2 - w / 2,
-                          context.get_height() / 2 - h / 2);
-        context.render_present();
+    SDL_Rect dirty = bricks.get_dirty();
+    context.begin_layer(bricks);
+    for (uint32_t i: blocks.get_alive()) {
+        SDL_Rect rect = blocks.get_rect(i);
+        rect.y -= bricks_band.y;
+        if (SDL_HasIntersection(&rect, &dirty))
+            context.draw_sprite(brick, rect);
     }
+    context.end_layer(bricks);
 }
 
-void Game::update(void)
+// How far the session is into the tick after `snapshot', from 0 to 1.
+float Game::get_alpha(const Snapshot& snapshot) const
 {
-    if (state == GameState::PAUSED) {
-        return;
-    } else if (state == GameState::START) {
-        // nothing to update
-    } else if (state == GameState::PLAYING) {
-        ball.update();
-        detect_ball_collision();
-    } else if (state == GameState::LOST) {
-        // nothing to update
-    }
+    uint64_t now = SDL_GetPerformanceCounter();
+    if (now <= snapshot.time) return 0.0f;
+    double ticks = (now - snapshot.time) * (double)tick_rate
+                   / SDL_GetPerformanceFrequency();
+    return std::min(ticks, 1.0);
 }
 
-/* Ball reflection heuristic (is this really correct?):
- * The player reflects the ball based on where it was hit (midpoint = straight
- * up, left side = angle to left and proportional to distance from midpoint,
- * right side same as left side). The "walls" (top, left, right) as well as the
- * bricks reflect according to the classic laws of reflection.
+/* The top of the view: the lead ball in the middle, as far as the level
+ * allows. Without a ball, the view rests at the bottom.
  */
-void Game::detect_ball_collision(void)
-{
-    shapes::Circle ball_circ = ball.get_circle();
-    int32_t screen_height    = context.get_height();
-    int32_t ball_radius      = ball_circ.get_width() / 2;
-
-    // collision/exit at bottom of screen
-    if (ball_circ.get_y() + ball_radius >= screen_height) {
-        state = GameState::LOST;
-        context.play_audio("./assets/sounds/lose_sound.wav");
-        return;
-    }
-
-    // collision between ball and player
-    if (ball.collides_with(player)) {
-        // NOTE: Vectors aren't normalized, so the ball will change its speed.
-        int32_t wzone = player.get_width() / player.num_zones;
-        int32_t diff  = std::max(1, ball_circ.get_x() - player.get_xpos());
-        int32_t zone  = std::min(10, diff / wzone + 1);
-
-        assert(zone > 0 && zone <= player.num_zones);
-        switch (zone) {
-        case 1:  ball.set_xdir(-9); ball.set_ydir(-4); break;
-        case 2:  ball.set_xdir(-7); ball.set_ydir(-5); break;
-        case 3:  ball.set_xdir(-7); ball.set_ydir(-4); break;
-        case 4:  ball.set_xdir(-6); ball.set_ydir(-5); break;
-        case 5:  ball.set_xdir(-4); ball.set_ydir(-7); break;
-        case 6:  ball.set_xdir(4);  ball.set_ydir(-7); break;
-        case 7:  ball.set_xdir(6);  ball.set_ydir(-5); break;
-        case 8:  ball.set_xdir(7);  ball.set_ydir(-4); break;
-        case 9:  ball.set_xdir(7);  ball.set_ydir(-5); break;
-        case 10: ball.set_xdir(9);  ball.set_ydir(-4); break;
-        }
-        return;
-    }
-
-    // collision between ball and bricks
-    size_t position = 0;
-    for (Block& block: blocks) {
-        if (ball.collides_with(block)) {
-            if (!ball.update_on_collision(block)) {
-                blocks.erase(blocks.begin()+position);
-                if (++score >= winning_score) state = GameState::WON;
-            }
-            return;
-        }
-        position++;
-    }
-
-    // collision between ball and left/right walls
-    if (ball.collides_with_wall(context.get_width())) {
-        ball.set_xdir(ball.get_xdir() * -1);
-        return;
-    }
-
-    // collision between ball and top wall
-    if (ball.collides_with_top()) {
-        ball.set_ydir(ball.get_ydir() * -1);
-        return;
-    }
-}
-
-void Game::update_x(Game::Direction dir)
+int32_t Game::get_camera(const Snapshot& snapshot, float alpha) const
 {
-    // we don't want to update coordinates in most states
-    if (state != GameState::PLAYING) return;
-
-    int32_t new_xpos  = player.get_xpos();
-    if (dir == Direction::LEFT)       new_xpos -= xoffset;
-    else if (dir == Direction::RIGHT) new_xpos += xoffset;
-    else context.quit_on_error("unknown direction on x axis");
-
-    int32_t win_width    = static_cast<int32_t>(context.get_width());
-    int32_t player_width = player.get_width();
-    if ((new_xpos >= 0) && (new_xpos + player_width <= win_width))
-        player.set_xpos(new_xpos);
-    else if (new_xpos < 0)
-        player.set_xpos(0);
-    else if (new_xpos + player_width > win_width)
-        player.set_xpos(win_width - player_width);
+    int32_t view   = context.get_height();
+    int32_t bottom = std::max(0, session.get_height() - view);
+    if (snapshot.balls.empty()) return bottom;
+    int32_t top = snapshot.balls.front().get_circle(alpha).get_y() - view / 2;
+    return std::clamp(top, 0, bottom);
 }
 
-bool Game::is_still_running(void)
+/* A graph of how long the last frames were busy (newest on the right), the
+ * line marks the frame budget. Frames over budget are drawn in red.
+ */
+void Game::draw_profile(void)
 {
-    if (state != GameState::LOST) return true;
-    return false;
+    const int32_t graph_w = 256, graph_h = 64;
+    const int32_t x0 = context.get_width() - graph_w - 10, y0 = 10;
+    const double  budget = profiler.get_budget();
+    const double  scale  = graph_h / (2.0 * budget); // budget at half height
+
+    context.next_layer(); // on top of the bricks
+    context.draw_rectangle(shade, { x0, y0, graph_w, graph_h });
+    context.next_layer(); // fills are sorted by color, see `DrawQueue'
+    uint32_t frames = std::min<uint32_t>(graph_w, profiler.get_count());
+    for (uint32_t age = 0; age < frames; age++) {
+        double  busy = profiler.get_busy(age);
+        int32_t h = std::min<int32_t>(graph_h, busy * scale + 1);
+        context.draw_rectangle(busy > budget ? red : green,
+                               { x0 + graph_w - 1 - (int32_t)age,
+                                 y0 + graph_h - h, 1, h });
+    }
+    context.next_layer();
+    context.draw_line(black, x0, y0 + graph_h/2, x0 + graph_w - 1,
+                      y0 + graph_h/2);
+
+    Profiler::Stats stats = profiler.get_busy_stats();
+    context.draw_text(arena.format("p50 %.1f  p99 %.1f  max %.1f ms",
+                                   stats.p50, stats.p99, stats.max),
+                      black, x0, y0 + graph_h + 4);
 }
 
-// NOTE: Should we do bounds-checking in this function?
-void Ball::update(void)
+/* Show the pressed button for a moment. What the click does is up to the
+ * session, it gets the click as a command.
+ * Here, we rely on the fact that just one button can be clicked at a time.
+ */
+void Game::left_button_press(int32_t x, int32_t y)
 {
-    if (started) {
-        circle.update_x(xdir);
-        circle.update_y(ydir);
+    if (session.get_snapshot().state == GameState::START) {
+        context.draw_layer(screen); // the pressed button on top of the menu
+        context.next_layer();
+        bool selected = false;
+        for (ui::Button& button: ui_buttons)
+            selected |= button.render(context, x, y, true);
+        if (selected) {
+            context.render_present();
+            SDL_Delay(150);
+        } else {
+            context.discard_frame();
+        }
     }
 }
 
-bool Ball::collides_with(Player player)
+/* Take the latest snapshot, and the events of the ticks up to it, false once
+ * the session is over. Events can arrive ahead of their snapshot, those wait.
+ */
+bool Game::update(void)
 {
-    // we use a squared hit box
-    int32_t b_left = circle.get_x() - circle.get_width()/2;
-    int32_t b_right = b_left + circle.get_width()/2;
-    int32_t b_bottom = circle.get_y() + circle.get_width()/2;
-    int32_t p_left = player.get_xpos();
-    int32_t p_right = p_left + player.get_width();
-    int32_t p_top = player.get_ypos();
-
-    if (b_right >= p_left && b_bottom >= p_top && b_left <= p_right)
-        return true;
-    return false;
-}
+    session.update();
+    const Snapshot& snapshot = session.get_snapshot();
+    if (snapshot.generation != blocks_generation) take_blocks(snapshot);
+
+    Notice notice;
+    while (session.next_notice(&notice)) pending.push_back(notice);
+    uint32_t handled = 0;
+    while (handled < pending.size() && pending[handled].tick <= snapshot.tick) {
+        const Notice& n = pending[handled++];
+        /* Hits from before the blocks were last taken are in them already
+         * (killing twice doesn't hurt), those of an older generation refer
+         * to blocks that are gone.
+         */
+        if (n.event.type == Simulation::EventType::BRICK_DESTROYED &&
+            n.generation == blocks_generation)
+            blocks.kill(n.event.block);
+        handle_event(n.event);
+    }
+    pending.erase(pending.begin(), pending.begin() + handled);
 
-bool Ball::collides_with_wall(int32_t win_width)
-{
-    int32_t b_left = circle.get_x() - circle.get_width()/2;
-    int32_t b_right = circle.get_x() + circle.get_width()/2;
-
-    if (b_left <= 0 && xdir < 0)
-        return true;
-    else if ( b_right >= win_width && xdir > 0)
-        return true;
-    return false;
+    update_particles(snapshot.state);
+    return !snapshot.quit;
 }
 
-bool Ball::collides_with_top(void)
+/* Copy the blocks of a new generation (other bricks were streamed in), the
+ * copy reuses the memory of the last one where it can.
+ */
+void Game::take_blocks(const Snapshot& snapshot)
 {
-    int32_t b_top = circle.get_y() - circle.get_width()/2;
-
-    if (b_top <= 0 && ydir < 0)
-        return true;
-    return false;
+    blocks            = *snapshot.blocks;
+    blocks_generation = snapshot.generation;
+    bricks_band       = snapshot.band;
+    bricks.invalidate();
 }
 
-bool Ball::collides_with(const Block& block)
+/* Move the particles by the time since the last frame. They freeze while the
+ * game is paused and are gone once it's over.
+ */
+void Game::update_particles(GameState state)
 {
-    int32_t ball_left = circle.get_x() - circle.get_width()/2;
-    int32_t ball_right = circle.get_x() + circle.get_width()/2;
-    int32_t ball_bottom = circle.get_y() + circle.get_width()/2;
-    int32_t ball_top = circle.get_y() - circle.get_width()/2;
-    int32_t block_left = block.get_x();
-    int32_t block_right = block.get_x() + block.get_width();
-    int32_t block_top = block.get_y();
-    int32_t block_bottom = block.get_y() + block.get_height();
-
-    if (ball_right >= block_left && ball_bottom >= block_top &&
-        ball_left <= block_right && ball_top <= block_bottom)
-        return true;
-    return false;
+    uint64_t now = SDL_GetPerformanceCounter();
+    float    dt  = particles_time ? (float)(now - particles_time)
+                                    / SDL_GetPerformanceFrequency() : 0.0f;
+    particles_time = now;
+    if (state == GameState::PLAYING)
+        particles.update(std::min(dt, 0.1f)); // no jumps after a stall
+    else if (state != GameState::PAUSED)
+        particles.clear();
 }
 
-bool Ball::update_on_collision(Block& block)
+/* React to whatever happened during the simulation ticks that are about to be
+ * shown. The simulation itself doesn't know anything about sounds or screens.
+ */
+void Game::handle_event(const Simulation::Event& event)
 {
-    bool keep_block = true;
-    int8_t new_strength = block.decrease_strength();
-    if (new_strength <= 0) keep_block = false;
-
-    int32_t ball_y   = circle.get_y();
-    int32_t top_y    = block.get_y();
-    int32_t bottom_y = top_y + block.get_height();
-
-    // check for all four possible ball directions which face was hit
-    assert(xdir != 0 && ydir != 0);
-    if (xdir > 0 && ydir > 0) {           // moving down and right
-        if (ball_y < top_y) ydir = -ydir; // top face collision
-        else                xdir = -xdir; // left face collision
-    } else if (xdir < 0 && ydir > 0) {    // moving down and left
-        if (ball_y < top_y) ydir = -ydir;
-        else         xdir = -xdir;
-    } else if (xdir > 0 && ydir < 0) {    // moving up and right
-        if (ball_y < bottom_y) xdir = -xdir;
-        else                   ydir = -ydir;
-    } else if (xdir < 0 && ydir < 0) {    // moving up and left
-        if (ball_y < bottom_y) xdir = -xdir;
-        else                   ydir = -ydir;
+    switch (event.type) {
+    case Simulation::EventType::LOST:
+    case Simulation::EventType::WON:
+        if (event.type == Simulation::EventType::LOST)
+            context.play_audio(lose);
+        // queued, the store writes it in the background
+        scores.submit(session.get_snapshot().score, time(nullptr));
+        screen.invalidate(); // in case it shows the high scores
+        break;
+    case Simulation::EventType::BRICK_HIT:
+    case Simulation::EventType::BRICK_DESTROYED:
+        if (event.type == Simulation::EventType::BRICK_DESTROYED) {
+            particles.spawn(event.rect, 40, debris);
+            particles.spawn(event.rect, 20, sparks);
+        } else {
+            particles.spawn(event.rect, 8, sparks);
+        }
+        bricks.invalidate({ event.rect.x, event.rect.y - bricks_band.y,
+                            event.rect.w, event.rect.h });
+        break;
     }
-
-    return keep_block;
-}
-
-void Game::start(void)
-{
-    if (state == GameState::START)
-        state = GameState::PLAYING;
 }
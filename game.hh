@@ -4,107 +4,82 @@
 #include <cstdint>
 #include <vector>
 
+#include "alloc.hh"
 #include "context.hh"
+#include "input.hh"
+#include "layer.hh"
+#include "particles.hh"
+#include "profiler.hh"
+#include "scores.hh"
+#include "session.hh"
 #include "shapes.hh"
 #include "ui.hh"
 
 class Game;
-struct Player;
-struct Ball;
-struct Block;
-
-struct Player {
-private:
-    SDL_Rect rect;
-public:
-    const uint8_t num_zones = 10;
-    constexpr Player(int32_t x, int32_t y, int32_t w, int32_t h)
-        : rect({ x, y, w, h }) {}
-
-    constexpr void     set_ypos(int32_t y)    { rect.y = y; }
-    constexpr void     set_xpos(int32_t x)    { rect.x = x; }
-    constexpr int32_t  get_xpos(void) const   { return rect.x; }
-    constexpr int32_t  get_ypos(void) const   { return rect.y; }
-    constexpr int32_t  get_width(void) const  { return rect.w; }
-    constexpr int32_t  get_height(void) const { return rect.h; }
-    constexpr SDL_Rect get_rect(void) const   { return rect; }
-};
-
-struct Ball {
-private:
-    shapes::Circle circle;
-    bool           started = false;
-    int32_t        xdir = 2, ydir = 3;
-public:
-    constexpr Ball(int32_t x, int32_t y, int32_t w) : circle({ x, y, w }) {}
-
-    void update(void);
-    bool update_on_collision(Block&);
-    bool collides_with(Player);
-    bool collides_with(const Block&);
-    bool collides_with_wall(int32_t);
-    bool collides_with_top(void);
-
-    constexpr void           start(void)             { started = true; }
-    constexpr shapes::Circle get_circle(void) const  { return circle; }
-    constexpr void           set_xdir(int32_t x)     { xdir = x; }
-    constexpr void           set_ydir(int32_t y)     { ydir = y; }
-    constexpr int32_t        get_xdir(void)          { return xdir; }
-    constexpr int32_t        get_ydir(void)          { return ydir; }
-};
-
-struct Block {
-private:
-    SDL_Rect rect;
-    uint8_t  strength;       // how often it needs to be hit to disappear
-    bool     indestructable; // this block never disappears
-public:
-    constexpr Block(int32_t x, int32_t y, int32_t w, int32_t h, int8_t s)
-        : rect({ x, y, w, h }), strength(s) {}
-
-    constexpr int8_t   get_strength(void) const      { return strength; }
-    constexpr int8_t   decrease_strength(void)       { return --strength; }
-    constexpr bool     is_indestructable(void) const { return indestructable; }
-    constexpr SDL_Rect get_rect(void) const          { return rect; }
-    constexpr int32_t  get_x(void) const             { return rect.x; }
-    constexpr int32_t  get_y(void) const             { return rect.y; }
-    constexpr int32_t  get_width(void) const         { return rect.w; }
-    constexpr int32_t  get_height(void) const        { return rect.h; }
-};
 
+/* The main thread's side of the game: it turns SDL events into commands for
+ * the `Session' and draws (and plays) whatever the session publishes. The
+ * state of the game lives in the session, `Game' only ever sees snapshots.
+ */
 class Game {
-    Context            context;
-    Player             player;
-    Ball               ball;
-    std::vector<Block> blocks;
-    const bool         draw_fps;
-    uint32_t           score = 0;
-    const uint32_t     winning_score = 15;
-    const uint8_t      xoffset = 15;
-    uint32_t           current_fps = 0;
+    Context           context;
+    Profiler          profiler;
+    InputQueue        input;
+    Session           session;
+    const uint32_t    tick_rate;
+    const bool        draw_fps;
+    uint32_t          current_fps = 0;
+    Sprite            brick;
+    Mixer::Sound      lose;    // see `lose_sound'
+    RenderLayer       bricks;  // all bricks, redrawn where they change
+    SDL_Rect          bricks_band = { 0, 0, 0, 0 }; // what `bricks' covers
+    BlockStore        blocks;  // the session's, kept up to date by notices
+    uint32_t          blocks_generation = 0; // see `Snapshot'
+    RenderLayer       screen;  // the last menu or end screen
+    scores::Store     scores;  // not opened for replays, see `main.cc'
+    std::vector<Notice> pending; // events of ticks that aren't shown yet
+    ParticlePool      particles { 100000 }; // debris of hit bricks
+    uint64_t          particles_time = 0; // when they were last moved
+    FrameArena        arena { 4096 }; // text of the current frame
+    uint64_t          allocations = 0; // of all threads, see `alloc.hh'
+    uint64_t          frame_allocations = 0; // during the last frame
 
     std::vector<ui::Button> ui_buttons;
 
-    enum class GameState { START, HIGHSCORE, PLAYING, PAUSED, WON, LOST };
-    GameState state = GameState::START;
+    GameState screen_state = GameState::PLAYING; // what `screen' shows
+
+    void handle_event(const Simulation::Event&);
+    void draw_screen(const Snapshot&);
+    void draw_scores(void);
+    void draw_bricks(void);
+    void take_blocks(const Snapshot&);
+    void update_particles(GameState);
+    void draw_profile(void);
+    float get_alpha(const Snapshot&) const;
+    int32_t get_camera(const Snapshot&, float) const;
 public:
-    enum class Direction { LEFT, RIGHT };
-
-    Game(bool = false);
+    Game(bool = false, uint32_t = Simulation::default_tick_rate,
+         const level::Map* = nullptr, bool = false);
 
     void render(void);
-    void start(void);
-    void toggle_pause(void);
-    void update(void);
-    void update_x(Direction);
-    void detect_ball_collision(void);
-    void key_press(void);
+    bool update(void);
     void left_button_press(int32_t, int32_t);
-    bool is_still_running(void);
 
-    GameState get_game_state(void)             { return state; }
+    InputQueue& get_input(void)                { return input; }
+    Session&    get_session(void)              { return session; }
+    scores::Store& get_scores(void)            { return scores; }
+    // whether the screen changes without input, see `main.cc'
+    bool      is_animated(void) const
+    {
+        return session.get_snapshot().state == GameState::PLAYING;
+    }
+    Profiler& get_profiler(void)               { return profiler; }
     void      update_current_fps(uint32_t fps) { current_fps = fps; }
-    void      start_ball(void)                 { ball.start(); }
+    void      reset_layers(void)
+    {
+        bricks.invalidate();
+        screen.invalidate();
+    }
 };
 
 #endif /* _GAME_H_ */
@@ -0,0 +1,104 @@
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_ttf.h>
+#include <string_view>
+
+#include "glyphs.hh"
+
+/* Rasterize all glyphs into one surface (simple shelf packing, row by row)
+ * and upload it as a single texture. Returns an error message on failure and
+ * `nullptr' otherwise, the caller decides how to handle the error.
+ */
+const char* GlyphAtlas::build(SDL_Renderer* renderer, TTF_Font* font)
+{
+    const SDL_Color white = { 255, 255, 255, 255 };
+    const uint32_t  num_glyphs = last_char - first_char + 1;
+    SDL_Surface*    rendered[num_glyphs];
+
+    release();
+    height = TTF_FontHeight(font);
+
+    int32_t pen_x = 0, pen_y = 0;
+    for (uint32_t i = 0; i < num_glyphs; i++) {
+        rendered[i] = TTF_RenderGlyph_Blended(font, first_char + i, white);
+        if (!rendered[i]) {
+            for (uint32_t j = 0; j < i; j++) SDL_FreeSurface(rendered[j]);
+            return TTF_GetError();
+        }
+
+        int32_t w = rendered[i]->w, h = rendered[i]->h;
+        if (pen_x + w > atlas_width) {
+            pen_x = 0;
+            pen_y += height;
+        }
+        int advance;
+        TTF_GlyphMetrics(font, first_char + i, NULL, NULL, NULL, NULL,
+                         &advance);
+        glyphs[i] = { { pen_x, pen_y, w, h }, advance };
+        pen_x += w;
+    }
+
+    SDL_Surface* atlas = SDL_CreateRGBSurfaceWithFormat(0, atlas_width,
+                                                        pen_y + height, 32,
+                                                        SDL_PIXELFORMAT_RGBA32);
+    const char* error = atlas ? nullptr : SDL_GetError();
+    for (uint32_t i = 0; i < num_glyphs; i++) {
+        if (!error) {
+            // copy the alpha channel as well instead of blending it away
+            SDL_SetSurfaceBlendMode(rendered[i], SDL_BLENDMODE_NONE);
+            SDL_Rect dest = glyphs[i].src;
+            if (SDL_BlitSurface(rendered[i], NULL, atlas, &dest) != 0)
+                error = SDL_GetError();
+        }
+        SDL_FreeSurface(rendered[i]);
+    }
+
+    if (!error) {
+        texture = SDL_CreateTextureFromSurface(renderer, atlas);
+        if (!texture) error = SDL_GetError();
+        else          SDL_SetTextureBlendMode(texture, SDL_BLENDMODE_BLEND);
+    }
+    if (atlas) SDL_FreeSurface(atlas);
+
+    return error;
+}
+
+// NOTE: Must be called before the renderer that created the atlas is gone.
+void GlyphAtlas::release(void)
+{
+    if (texture) SDL_DestroyTexture(texture);
+    texture = nullptr;
+}
+
+// Characters outside of the printable ASCII range are skipped.
+const GlyphAtlas::Glyph* GlyphAtlas::get_glyph(char c) const
+{
+    uint8_t uc = static_cast<uint8_t>(c);
+    if (uc < first_char || uc > last_char) return nullptr;
+    return &glyphs[uc - first_char];
+}
+
+void GlyphAtlas::measure(std::string_view text, int32_t* w, int32_t* h) const
+{
+    int32_t width = 0;
+    for (char c: text)
+        if (const Glyph* g = get_glyph(c)) width += g->advance;
+    if (w) *w = width;
+    if (h) *h = height;
+}
+
+// Queue `text' with its top left corner at (x,y).
+void GlyphAtlas::draw(DrawQueue& queue, std::string_view text,
+                      const SDL_Color& color, int32_t x, int32_t y) const
+{
+    if (!texture) return;
+
+    int32_t pen_x = x;
+    for (char c: text) {
+        const Glyph* g = get_glyph(c);
+        if (!g) continue;
+
+        SDL_Rect dest = { pen_x, y, g->src.w, g->src.h };
+        queue.texture(texture, &g->src, dest, color);
+        pen_x += g->advance;
+    }
+}
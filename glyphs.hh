@@ -0,0 +1,45 @@
+#ifndef _GLYPHS_H_
+#define _GLYPHS_H_
+
+#include <cstdint>
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_ttf.h>
+#include <string_view>
+
+#include "draw.hh"
+
+/* A `GlyphAtlas' holds every printable ASCII glyph of one font in a single
+ * texture. It's built once (rasterizing glyphs is expensive), afterwards text
+ * is queued as textured quads (which the `DrawQueue' batches) and measured
+ * from the cached glyph metrics. Glyphs are rasterized in white, the color is
+ * applied per vertex.
+ */
+class GlyphAtlas {
+    static constexpr uint8_t first_char = ' ';
+    static constexpr uint8_t last_char  = '~';
+    static constexpr int32_t atlas_width = 512;
+
+    struct Glyph {
+        SDL_Rect src;     // location in the atlas texture
+        int32_t  advance; // how far to move the pen after drawing
+    };
+
+    SDL_Texture* texture = nullptr;
+    Glyph        glyphs[last_char - first_char + 1];
+    int32_t      height = 0; // line height of the font
+
+    const Glyph* get_glyph(char) const;
+public:
+    GlyphAtlas(void) = default;
+    GlyphAtlas(const GlyphAtlas&) = delete;
+    ~GlyphAtlas(void) { release(); }
+    GlyphAtlas& operator=(const GlyphAtlas&) = delete;
+
+    const char* build(SDL_Renderer*, TTF_Font*);
+    void        release(void);
+    void        measure(std::string_view, int32_t*, int32_t*) const;
+    void        draw(DrawQueue&, std::string_view, const SDL_Color&,
+                     int32_t, int32_t) const;
+};
+
+#endif /* _GLYPHS_H_ */
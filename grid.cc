@@ -0,0 +1,105 @@
+#include <algorithm>
+
+#include "grid.hh"
+
+/* Throw away all blocks and cover a `width' x `height' area starting at row
+ * `top' with cells of the given size. Blocks outside of that area are clamped
+ * into the border cells, so they are still found (just less efficiently).
+ */
+void BlockGrid::reset(int32_t width, int32_t height, int32_t cell_size,
+                      int32_t top)
+{
+    this->cell_size = cell_size;
+    this->top       = top;
+    cols = std::max(1, (width + cell_size - 1) / cell_size);
+    rows = std::max(1, (height + cell_size - 1) / cell_size);
+    entries.clear();
+    blocks.clear();
+    first.assign(cols * rows + 1, 0);
+    last.assign(cols * rows, 0);
+    seen.clear();
+    query_id = 0;
+}
+
+void BlockGrid::cell_range(const SDL_Rect& r, int32_t* x0, int32_t* y0,
+                           int32_t* x1, int32_t* y1) const
+{
+    // floor division, so that negative coordinates end up in the first cell
+    auto cell = [&](int32_t v) {
+        return v >= 0 ? v / cell_size : (v - cell_size + 1) / cell_size;
+    };
+    *x0 = std::clamp(cell(r.x), 0, cols - 1);
+    *y0 = std::clamp(cell(r.y - top), 0, rows - 1);
+    *x1 = std::clamp(cell(r.x + r.w), 0, cols - 1);
+    *y1 = std::clamp(cell(r.y - top + r.h), 0, rows - 1);
+}
+
+void BlockGrid::insert(uint32_t index, const SDL_Rect& rect)
+{
+    int32_t x0, y0, x1, y1;
+    cell_range(rect, &x0, &y0, &x1, &y1);
+    for (int32_t y = y0; y <= y1; y++)
+        for (int32_t x = x0; x <= x1; x++)
+            entries.push_back((uint64_t)(y*cols + x) << 32 | index);
+
+    if (index >= seen.size()) seen.resize(index + 1, 0);
+}
+
+/* Sort the inserted blocks into their cells (a counting sort, the blocks of a
+ * cell stay in the order they were inserted in).
+ */
+void BlockGrid::build(void)
+{
+    const uint32_t num_cells = cols * rows;
+    for (uint64_t entry: entries) first[(entry >> 32) + 1]++;
+    for (uint32_t c = 0; c < num_cells; c++) first[c + 1] += first[c];
+
+    blocks.resize(entries.size());
+    std::copy(first.begin(), first.end() - 1, last.begin());
+    for (uint64_t entry: entries)
+        blocks[last[entry >> 32]++] = (uint32_t)entry;
+    entries.clear();
+}
+
+// `rect' must be the same rectangle the block was inserted with.
+void BlockGrid::remove(uint32_t index, const SDL_Rect& rect)
+{
+    int32_t x0, y0, x1, y1;
+    cell_range(rect, &x0, &y0, &x1, &y1);
+    for (int32_t y = y0; y <= y1; y++)
+        for (int32_t x = x0; x <= x1; x++) {
+            const uint32_t cell = y*cols + x;
+            uint32_t* begin = blocks.data() + first[cell];
+            uint32_t* end   = blocks.data() + last[cell];
+            uint32_t* it    = std::find(begin, end, index);
+            if (it != end) {
+                *it = end[-1];
+                last[cell]--;
+            }
+        }
+}
+
+/* Append the indices of all blocks in cells touched by `rect' to `out'. These
+ * are candidates only, the caller still has to do the exact overlap test.
+ */
+void BlockGrid::query(const SDL_Rect& rect, std::vector<uint32_t>& out)
+{
+    if (++query_id == 0) { // wrapped around, old marks might look current
+        std::fill(seen.begin(), seen.end(), 0);
+        query_id = 1;
+    }
+
+    int32_t x0, y0, x1, y1;
+    cell_range(rect, &x0, &y0, &x1, &y1);
+    for (int32_t y = y0; y <= y1; y++)
+        for (int32_t x = x0; x <= x1; x++) {
+            const uint32_t cell = y*cols + x;
+            for (uint32_t i = first[cell]; i < last[cell]; i++) {
+                uint32_t index = blocks[i];
+                if (seen[index] != query_id) {
+                    seen[index] = query_id;
+                    out.push_back(index);
+                }
+            }
+        }
+}
@@ -0,0 +1,43 @@
+#ifndef _GRID_H_
+#define _GRID_H_
+
+#include <cstdint>
+#include <SDL2/SDL_rect.h>
+#include <vector>
+
+/* `BlockGrid' is a uniform grid over the level that remembers which blocks
+ * overlap each cell, so that collision checks only need to look at the blocks
+ * near the ball instead of all of them. Blocks are referred to by their index
+ * (the grid doesn't know about `Block' itself). A block that spans several
+ * cells is stored in each of them, `query()' reports it only once.
+ * The cells are slices of one array: after `reset()', all blocks are
+ * `insert()'ed and `build()' sorts them into their cells. Only `remove()'
+ * works on a built grid. All arrays keep their memory, so rebuilding the
+ * grid (like when streaming) doesn't allocate unless it holds more blocks
+ * than ever before.
+ */
+class BlockGrid {
+    int32_t cell_size = 64;
+    int32_t cols = 0, rows = 0;
+    int32_t top = 0; // of the area covered by the first row
+
+    std::vector<uint64_t> entries; // cell << 32 | block, until `build()'
+    std::vector<uint32_t> blocks;  // by cell, see `first' and `last'
+    std::vector<uint32_t> first;   // of each cell in `blocks'
+    std::vector<uint32_t> last;    // one past it, less after `remove()'
+    std::vector<uint32_t> seen;    // per block, see `query()'
+    uint32_t              query_id = 0;
+
+    void cell_range(const SDL_Rect&, int32_t*, int32_t*, int32_t*,
+                    int32_t*) const;
+public:
+    void reset(int32_t, int32_t, int32_t, int32_t = 0);
+    void insert(uint32_t, const SDL_Rect&);
+    void build(void);
+    void remove(uint32_t, const SDL_Rect&);
+    void query(const SDL_Rect&, std::vector<uint32_t>&);
+
+    constexpr int32_t get_cell_size(void) const { return cell_size; }
+};
+
+#endif /* _GRID_H_ */
@@ -0,0 +1,121 @@
+#include "input.hh"
+
+/* NOTE: If the simulation thread doesn't keep up (it takes everything at
+ * least once per tick), commands are dropped rather than blocking. Returns
+ * false if this one was.
+ */
+bool InputQueue::push(uint32_t time, replay::Command command, int32_t x,
+                      int32_t y)
+{
+    if (!queue.push({ time, command, (int16_t)x, (int16_t)y })) return false;
+    wake();
+    return true;
+}
+
+/* Tell the simulation about arrow keys that changed. A change that was
+ * dropped is sent again with the next event, or the paddle would keep moving
+ * after its key was released.
+ */
+void InputQueue::sync_keys(uint32_t time)
+{
+    using replay::Command;
+
+    if (held_left != key_left &&
+        push(time, key_left ? Command::LEFT_DOWN : Command::LEFT_UP))
+        held_left = key_left;
+    if (held_right != key_right &&
+        push(time, key_right ? Command::RIGHT_DOWN : Command::RIGHT_UP))
+        held_right = key_right;
+}
+
+// Interrupt `wait()' (e.g. because the simulation thread should stop).
+void InputQueue::wake(void)
+{
+    pushed.fetch_add(1, std::memory_order_release);
+    pushed.notify_one();
+}
+
+// Queue whatever `event' stands for. Returns false if it asks to quit.
+bool InputQueue::handle(const SDL_Event& event)
+{
+    using replay::Command;
+
+    switch (event.type) {
+    case SDL_QUIT:
+        return false;
+    case SDL_KEYDOWN:
+    case SDL_KEYUP:
+        {
+            bool     down = event.type == SDL_KEYDOWN;
+            uint32_t time = event.key.timestamp;
+            switch (event.key.keysym.scancode) {
+            case SDL_SCANCODE_LEFT:
+                key_left = down;
+                break;
+            case SDL_SCANCODE_RIGHT:
+                key_right = down;
+                break;
+            case SDL_SCANCODE_Q:
+                if (down) return false;
+                break;
+            default:
+                if (!down || event.key.repeat) break;
+                if (event.key.keysym.scancode == SDL_SCANCODE_P)
+                    push(time, Command::PAUSE);
+                else if (event.key.keysym.scancode == SDL_SCANCODE_SPACE)
+                    push(time, Command::START);
+                else
+                    push(time, Command::KEY);
+                break;
+            }
+        }
+        break;
+    case SDL_MOUSEBUTTONDOWN:
+        if (event.button.button == SDL_BUTTON_LEFT)
+            push(event.button.timestamp, Command::CLICK, event.button.x,
+                 event.button.y);
+        break;
+    default:
+        break;
+    }
+    sync_keys(event.common.timestamp);
+    return true;
+}
+
+// Make sure `next' holds the oldest command, if there is any.
+bool InputQueue::peek(void)
+{
+    if (!has_next) has_next = queue.pop(&next);
+    return has_next;
+}
+
+/* Hand out the next command that happened before `time' (milliseconds, same
+ * clock as the event timestamps). `entry->tick' is left to the caller.
+ */
+bool InputQueue::next_due(uint32_t time, replay::Entry* entry)
+{
+    // timestamps wrap after 49 days, compare the difference
+    if (!peek() || (int32_t)(next.time - time) >= 0) return false;
+
+    entry->command = next.command;
+    entry->x       = next.x;
+    entry->y       = next.y;
+    has_next = false;
+    return true;
+}
+
+void InputQueue::clear(void)
+{
+    while (peek()) has_next = false;
+}
+
+/* Block until there's a command to take or `cancel' is set (whoever sets it
+ * calls `wake()' after). Checking `cancel' after `pushed' doesn't miss a
+ * wake-up that comes in between.
+ */
+void InputQueue::wait(const std::atomic<bool>& cancel)
+{
+    uint32_t seen = pushed.load(std::memory_order_acquire);
+    if (peek() || cancel.load(std::memory_order_acquire)) return;
+    pushed.wait(seen, std::memory_order_acquire);
+}
@@ -0,0 +1,53 @@
+#ifndef _INPUT_H_
+#define _INPUT_H_
+
+#include <atomic>
+#include <cstdint>
+#include <SDL2/SDL.h>
+
+#include "replay.hh"
+#include "spsc.hh"
+
+/* Turns SDL events into `replay::Command's and keeps each of them, with the
+ * time it happened at, until the simulation reaches the tick that covers that
+ * time. So a key pressed while the last frame was rendered takes effect at
+ * the right tick, not at the start of the next batch of ticks.
+ * Arrow keys are tracked as held down or released (the paddle moves while
+ * one is held), key repeat doesn't produce any commands.
+ *
+ * The main thread `handle()'s events, the simulation thread takes commands
+ * with `next_due()'; the queue between them doesn't lock.
+ */
+class InputQueue {
+    struct Pending {
+        uint32_t        time; // SDL timestamp in milliseconds
+        replay::Command command;
+        int16_t         x, y;
+    };
+
+    SpscQueue<Pending, 256> queue;
+    std::atomic<uint32_t>   pushed = 0; // changes with every push, see `wait()'
+
+    // main thread only: the arrow keys, and what the simulation was told
+    bool key_left   = false, key_right  = false;
+    bool held_left  = false, held_right = false;
+
+    // simulation thread only: taken from `queue' but not due yet
+    Pending next;
+    bool    has_next = false;
+
+    bool push(uint32_t, replay::Command, int32_t = 0, int32_t = 0);
+    void sync_keys(uint32_t);
+    bool peek(void);
+public:
+    // main thread
+    bool handle(const SDL_Event&);
+    void wake(void);
+
+    // simulation thread
+    bool next_due(uint32_t, replay::Entry*);
+    void clear(void);
+    void wait(const std::atomic<bool>&);
+};
+
+#endif /* _INPUT_H_ */
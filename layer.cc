@@ -0,0 +1,76 @@
+#include "layer.hh"
+
+/* Create the (transparent) texture of a `width' x `height' layer. The whole
+ * layer is dirty afterwards. Returns an error message or `nullptr'.
+ */
+const char* RenderLayer::create(SDL_Renderer* renderer, int32_t width,
+                                int32_t height)
+{
+    release();
+    texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_RGBA32,
+                                SDL_TEXTUREACCESS_TARGET, width, height);
+    if (!texture) return SDL_GetError();
+    SDL_SetTextureBlendMode(texture, SDL_BLENDMODE_BLEND);
+
+    this->width  = width;
+    this->height = height;
+    invalidate();
+    return nullptr;
+}
+
+// NOTE: Must be called before the renderer that created the layer is gone.
+void RenderLayer::release(void)
+{
+    if (texture) SDL_DestroyTexture(texture);
+    texture = nullptr;
+    width = height = 0;
+    dirty = { 0, 0, 0, 0 };
+}
+
+// Everything needs to be drawn again (e.g. the render targets were reset).
+void RenderLayer::invalidate(void)
+{
+    dirty = get_rect();
+}
+
+void RenderLayer::invalidate(const SDL_Rect& rect)
+{
+    SDL_Rect bounds = get_rect(), r;
+    if (!SDL_IntersectRect(&rect, &bounds, &r)) return;
+    if (is_dirty()) SDL_UnionRect(&dirty, &r, &dirty);
+    else            dirty = r;
+}
+
+/* Clear the dirty area to transparent and draw whatever was queued since the
+ * last redraw into it. The renderer's target, clip rectangle and draw state
+ * are restored afterwards. Returns an error message or `nullptr'.
+ */
+const char* RenderLayer::redraw(SDL_Renderer* renderer)
+{
+    if (!texture) {
+        queue.discard();
+        return "the layer wasn't created";
+    }
+
+    SDL_Texture* previous = SDL_GetRenderTarget(renderer);
+    if (SDL_SetRenderTarget(renderer, texture) != 0) {
+        queue.discard(); // the area stays dirty, it's queued again next time
+        return SDL_GetError();
+    }
+    SDL_RenderSetClipRect(renderer, &dirty);
+
+    // overwrite instead of blending, otherwise nothing would be cleared
+    SDL_BlendMode mode;
+    SDL_GetRenderDrawBlendMode(renderer, &mode);
+    SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_NONE);
+    SDL_SetRenderDrawColor(renderer, 0, 0, 0, 0);
+    SDL_RenderFillRect(renderer, &dirty);
+    SDL_SetRenderDrawBlendMode(renderer, mode);
+
+    queue.flush(renderer);
+
+    SDL_RenderSetClipRect(renderer, nullptr);
+    SDL_SetRenderTarget(renderer, previous);
+    dirty = { 0, 0, 0, 0 };
+    return nullptr;
+}
@@ -0,0 +1,40 @@
+#ifndef _LAYER_H_
+#define _LAYER_H_
+
+#include <cstdint>
+#include <SDL2/SDL.h>
+
+#include "draw.hh"
+
+/* A `RenderLayer' caches a part of the scene that rarely changes (e.g. the
+ * bricks) in a render target texture, so a frame only has to copy it instead
+ * of drawing everything in it again. Areas that changed are marked with
+ * `invalidate()'; a redraw (see `Context::begin_layer()') only clears their
+ * bounding box and everything drawn into the layer is clipped to it, the
+ * rest of the texture stays as it is.
+ */
+class RenderLayer {
+    SDL_Texture* texture = nullptr;
+    DrawQueue    queue;                   // what's drawn in the next redraw
+    SDL_Rect     dirty = { 0, 0, 0, 0 };  // bounding box of the changes
+    int32_t      width = 0, height = 0;
+public:
+    RenderLayer(void) = default;
+    RenderLayer(const RenderLayer&) = delete;
+    ~RenderLayer(void) { release(); }
+    RenderLayer& operator=(const RenderLayer&) = delete;
+
+    const char* create(SDL_Renderer*, int32_t, int32_t);
+    void        release(void);
+    void        invalidate(void);
+    void        invalidate(const SDL_Rect&);
+    const char* redraw(SDL_Renderer*);
+
+    bool            is_dirty(void) const    { return dirty.w && dirty.h; }
+    const SDL_Rect& get_dirty(void) const   { return dirty; }
+    DrawQueue&      get_queue(void)         { return queue; }
+    SDL_Texture*    get_texture(void) const { return texture; }
+    SDL_Rect        get_rect(void) const    { return { 0, 0, width, height }; }
+};
+
+#endif /* _LAYER_H_ */
@@ -0,0 +1,171 @@
+#include <algorithm>
+#include <bit>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "level.hh"
+#include "sim.hh"
+
+static_assert(std::endian::native == std::endian::little,
+              "level files are mapped as they are, in little endian");
+static_assert(sizeof(level::Header) == 32 && sizeof(level::Chunk) == 16 &&
+              sizeof(level::Brick) == 16, "the layout on disk");
+
+static const char magic[4] = { 'B', 'R', 'K', 'V' };
+static const uint32_t version = 1;
+
+/* Write a `width' x `height' level with the given blocks to `path', cut into
+ * chunks of `chunk_height' pixels. Blocks must lie within the level and be at
+ * most one chunk high.
+ */
+const char* level::write(const char* path, int32_t width, int32_t height,
+                         int32_t chunk_height, const std::vector<Block>& blocks)
+{
+    if (width <= 0 || height <= 0 || chunk_height <= 0)
+        return "the level and its chunks can't be empty";
+    for (const Block& block: blocks) {
+        if (block.get_x() < 0 || block.get_x() + block.get_width() > width ||
+            block.get_y() < 0 || block.get_y() >= height)
+            return "a brick lies outside the level";
+        if (block.get_width() <= 0 || block.get_width() > UINT16_MAX ||
+            block.get_height() <= 0 || block.get_height() > chunk_height)
+            return "a brick is empty or higher than a chunk";
+        if (block.get_strength() <= 0)
+            return "a brick has no strength";
+    }
+
+    // bricks sorted by chunk, otherwise in the given order
+    uint32_t num_chunks = (height + chunk_height - 1) / chunk_height;
+    std::vector<Chunk> chunks(num_chunks, Chunk { 0, 0, 0 });
+    for (const Block& block: blocks)
+        chunks[block.get_y() / chunk_height].count++;
+    uint64_t offset = sizeof(Header) + num_chunks * sizeof(Chunk);
+    for (Chunk& chunk: chunks) {
+        chunk.offset = offset;
+        offset += chunk.count * sizeof(Brick);
+    }
+
+    std::vector<Brick> bricks(blocks.size());
+    std::vector<uint64_t> next(num_chunks);
+    for (uint32_t i = 0; i < num_chunks; i++)
+        next[i] = (chunks[i].offset - chunks[0].offset) / sizeof(Brick);
+    for (const Block& block: blocks) {
+        Brick& brick = bricks[next[block.get_y() / chunk_height]++];
+        brick = { block.get_x(), block.get_y(), (uint16_t)block.get_width(),
+                  (uint16_t)block.get_height(),
+                  (uint8_t)block.get_strength(), { 0, 0, 0 } };
+    }
+
+    FILE* file = fopen(path, "wb");
+    if (!file) return "unable to open the level for writing";
+
+    Header header = { {}, version, width, height, chunk_height, num_chunks,
+                      blocks.size() };
+    memcpy(header.magic, magic, sizeof(magic));
+    fwrite(&header, sizeof(header), 1, file);
+    fwrite(chunks.data(), sizeof(Chunk), chunks.size(), file);
+    fwrite(bricks.data(), sizeof(Brick), bricks.size(), file);
+    bool failed = ferror(file);
+    if (fclose(file) != 0 || failed) return "unable to write the level";
+    return nullptr;
+}
+
+/* Map the level at `path'. The header and the chunk table are checked right
+ * away, the bricks are only read (and paged in) once they're used.
+ */
+const char* level::Map::open(const char* path)
+{
+    close();
+    int fd = ::open(path, O_RDONLY);
+    if (fd < 0) return "unable to open the level";
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(Header)) {
+        ::close(fd);
+        return "the level is not a level file";
+    }
+    void* mapped = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd); // the mapping keeps the file open
+    if (mapped == MAP_FAILED) return "unable to map the level";
+    data   = (const uint8_t*)mapped;
+    size   = st.st_size;
+    header = (const Header*)data;
+    chunks = (const Chunk*)(data + sizeof(Header));
+
+    const char* error = nullptr;
+    uint64_t    table = sizeof(Header) + (uint64_t)header->num_chunks
+                                         * sizeof(Chunk);
+    if (memcmp(header->magic, magic, sizeof(magic)) != 0)
+        error = "the level is not a level file";
+    else if (header->version != version)
+        error = "the level has an unsupported version";
+    else if (header->width <= 0 || header->height <= 0 ||
+             header->chunk_height <= 0 ||
+             header->num_chunks != (uint32_t)((header->height - 1)
+                                              / header->chunk_height + 1) ||
+             table > size)
+        error = "the level is corrupt";
+
+    uint64_t total = 0;
+    for (uint32_t i = 0; !error && i < header->num_chunks; i++) {
+        const Chunk& chunk = chunks[i];
+        if (chunk.offset < table || chunk.offset % alignof(Brick) != 0 ||
+            chunk.offset + (uint64_t)chunk.count * sizeof(Brick) > size)
+            error = "the level is corrupt";
+        total += chunk.count;
+    }
+    if (!error && total != header->num_bricks)
+        error = "the level is corrupt";
+
+    if (error) close();
+    return error;
+}
+
+void level::Map::close(void)
+{
+    if (data) munmap((void*)data, size);
+    data   = nullptr;
+    size   = 0;
+    header = nullptr;
+    chunks = nullptr;
+}
+
+// The chunk that contains row `y', clamped to the level.
+uint32_t level::Map::find_chunk(int32_t y) const
+{
+    int32_t chunk = std::max(0, y) / header->chunk_height;
+    return std::min<uint32_t>(chunk, header->num_chunks - 1);
+}
+
+// Pass `advice' on for the whole pages in `chunk'.
+void level::Map::advise(uint32_t chunk, int advice) const
+{
+    const size_t page  = sysconf(_SC_PAGESIZE);
+    size_t       begin = chunks[chunk].offset;
+    size_t       end   = begin + chunks[chunk].count * sizeof(Brick);
+    if (advice == MADV_WILLNEED) {
+        begin = begin / page * page; // partial pages are welcome too
+    } else {
+        // the neighbours' bricks might share the partial pages
+        begin = (begin + page - 1) / page * page;
+        end   = end / page * page;
+    }
+    if (begin < end)
+        madvise((void*)(data + begin), end - begin, advice);
+}
+
+// Start loading the pages of `chunk' in the background.
+void level::Map::prefetch(uint32_t chunk) const
+{
+    advise(chunk, MADV_WILLNEED);
+}
+
+// Let the kernel drop the pages of `chunk', they're read again when needed.
+void level::Map::release(uint32_t chunk) const
+{
+    advise(chunk, MADV_DONTNEED);
+}
@@ -0,0 +1,87 @@
+#ifndef _LEVEL_H_
+#define _LEVEL_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+struct Block;
+
+/* Levels are stored in a binary file that is mapped into memory rather than
+ * read, so opening one costs the same no matter how many bricks it has, and
+ * only the pages of bricks that are actually used get loaded. The level is
+ * cut into horizontal chunks of `chunk_height' pixels; the bricks of a chunk
+ * (those whose top edge lies in it) are stored next to each other:
+ *     header   "BRKV", version, level size, chunk height, counts
+ *     chunks   per chunk from the top: offset of its first brick (from the
+ *              start of the file) and number of bricks
+ *     bricks   x, y, w, h, strength
+ * All numbers are little endian, like the machines the game runs on. The
+ * structs below are the exact layout on disk.
+ */
+namespace level {
+    struct Header {
+        char     magic[4];
+        uint32_t version;
+        int32_t  width, height;
+        int32_t  chunk_height;
+        uint32_t num_chunks;
+        uint64_t num_bricks;
+    };
+
+    struct Chunk {
+        uint64_t offset;
+        uint32_t count;
+        uint32_t reserved;
+    };
+
+    struct Brick {
+        int32_t  x, y;
+        uint16_t w, h; // at most `chunk_height' high
+        uint8_t  strength;
+        uint8_t  reserved[3];
+    };
+
+    class Map;
+
+    const char* write(const char*, int32_t, int32_t, int32_t,
+                      const std::vector<Block>&);
+}
+
+/* A level file mapped read-only. The chunks can be `prefetch()'ed before
+ * they're needed and `release()'d once they aren't, which only tells the
+ * kernel what to load or drop; their bricks stay valid either way.
+ */
+class level::Map {
+    const uint8_t* data = nullptr;
+    size_t         size = 0;
+    const Header*  header = nullptr;
+    const Chunk*   chunks = nullptr;
+
+    void advise(uint32_t, int) const;
+public:
+    Map(void) = default;
+    Map(const Map&) = delete;
+    ~Map(void) { close(); }
+    Map& operator=(const Map&) = delete;
+
+    const char* open(const char*);
+    void        close(void);
+    void        prefetch(uint32_t) const;
+    void        release(uint32_t) const;
+    uint32_t    find_chunk(int32_t) const;
+
+    bool     is_open(void) const            { return data != nullptr; }
+    int32_t  get_width(void) const          { return header->width; }
+    int32_t  get_height(void) const         { return header->height; }
+    int32_t  get_chunk_height(void) const   { return header->chunk_height; }
+    uint32_t get_num_chunks(void) const     { return header->num_chunks; }
+    uint64_t get_num_bricks(void) const     { return header->num_bricks; }
+    uint32_t get_count(uint32_t chunk) const { return chunks[chunk].count; }
+    const Brick* get_bricks(uint32_t chunk) const
+    {
+        return (const Brick*)(data + chunks[chunk].offset);
+    }
+};
+
+#endif /* _LEVEL_H_ */
@@ -0,0 +1,122 @@
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "level.hh"
+#include "sim.hh"
+
+/* Writes level files for `breakout -level=<file>', see `level.hh'. Either
+ * converts a text layout (one line per row of bricks, a digit is a brick of
+ * that strength, anything else a gap) or generates `rows' random rows. Bricks
+ * are laid out like in the default level, with room for the paddle below.
+ * Linked against the simulation library only.
+ */
+static const int32_t brick_width  = 80;
+static const int32_t brick_height = 40;
+static const int32_t xmargin      = 10;
+static const int32_t ymargin      = 5;
+static const int32_t clearance    = 400; // below the last row of bricks
+
+static void usage(void)
+{
+    std::cerr << "usage: breakout_levelgen -out=<file> "
+                 "[-from=<text file> | -rows=<n> [-seed=<n>]]\n"
+                 "                         [-width=<px>] [-chunk=<px>]\n";
+    exit(1);
+}
+
+static uint32_t parse_number(const char* value)
+{
+    char* end;
+    unsigned long number = strtoul(value, &end, 10);
+    if (*end != '\0' || number == 0 || number > INT32_MAX) usage();
+    return number;
+}
+
+// xorshift32, so the same seed gives the same level everywhere
+static uint32_t next_random(uint32_t* state)
+{
+    uint32_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return *state = x;
+}
+
+static Block make_brick(int32_t column, int32_t row, int8_t strength)
+{
+    return Block(column * brick_width + (column + 1) * xmargin,
+                 row * brick_height + (row + 1) * ymargin, brick_width,
+                 brick_height, strength);
+}
+
+int main(int argc, char** argv)
+{
+    const char* out_path  = nullptr;
+    const char* from_path = nullptr;
+    uint32_t    rows      = 0;
+    uint32_t    seed      = 1;
+    int32_t     width     = 910;
+    int32_t     chunk     = 256;
+    for (int i = 1; i < argc; i++) {
+        if (strncmp(argv[i], "-out=", 5) == 0 && argv[i][5] != '\0')
+            out_path = argv[i] + 5;
+        else if (strncmp(argv[i], "-from=", 6) == 0 && argv[i][6] != '\0')
+            from_path = argv[i] + 6;
+        else if (strncmp(argv[i], "-rows=", 6) == 0)
+            rows = parse_number(argv[i] + 6);
+        else if (strncmp(argv[i], "-seed=", 6) == 0)
+            seed = parse_number(argv[i] + 6);
+        else if (strncmp(argv[i], "-width=", 7) == 0)
+            width = parse_number(argv[i] + 7);
+        else if (strncmp(argv[i], "-chunk=", 7) == 0)
+            chunk = parse_number(argv[i] + 7);
+        else
+            usage();
+    }
+    if (!out_path || (from_path != nullptr) == (rows != 0)) usage();
+
+    const int32_t columns = (width - xmargin) / (brick_width + xmargin);
+    std::vector<Block> bricks;
+    if (from_path) {
+        std::ifstream file(from_path);
+        if (!file) {
+            std::cerr << "error: unable to open " << from_path << '\n';
+            return 1;
+        }
+        std::string line;
+        for (rows = 0; std::getline(file, line); rows++)
+            for (int32_t x = 0; x < std::min<int32_t>(columns, line.size());
+                 x++)
+                if (line[x] >= '1' && line[x] <= '9')
+                    bricks.push_back(make_brick(x, rows, line[x] - '0'));
+    } else {
+        // about one gap in eight, the rest of strength 1 to 4
+        for (uint32_t y = 0; y < rows; y++)
+            for (int32_t x = 0; x < columns; x++) {
+                uint32_t r = next_random(&seed);
+                if (r % 8 != 0)
+                    bricks.push_back(make_brick(x, y, r / 8 % 4 + 1));
+            }
+    }
+
+    int64_t height = (int64_t)rows * (brick_height + ymargin) + ymargin
+                     + clearance;
+    if (height > INT32_MAX) {
+        std::cerr << "error: the level is too high\n";
+        return 1;
+    }
+    if (const char* error = level::write(out_path, width, height, chunk,
+                                         bricks)) {
+        std::cerr << "error: " << error << '\n';
+        return 1;
+    }
+    printf("wrote %zu bricks, %d x %lld px\n", bricks.size(), width,
+           (long long)height);
+    return 0;
+}
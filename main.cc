@@ -1,24 +1,136 @@
+#include <cstdio>
 #include <cstdlib>
+#include <ctime>
 #include <cstring>
 #include <iostream>
 #include <SDL2/SDL.h>
 
 #include "game.hh"
+#include "input.hh"
+#include "level.hh"
+#include "replay.hh"
+#include "session.hh"
 
-static const uint32_t fps = 60;
-static const uint32_t ms_per_frame = 1000 / fps;
+/* The simulation runs on its own thread at a fixed tick rate (see `Session'),
+ * independent of how fast frames are displayed. The main thread only pumps
+ * events and draws the latest snapshot, at most `fps' times a second.
+ */
+static const uint32_t default_fps = 60;
+
+/* While nothing moves on screen (menus, pause, end screens), the loop blocks
+ * until an event arrives instead and draws only after one. The timeout just
+ * bounds how long it sleeps in one go.
+ */
+static const uint32_t idle_timeout_ms = 500;
 
 void usage(void)
 {
-    std::cerr << "usage: breakout <print_fps=bool>\n";
+    std::cerr << "usage: breakout -print_fps=<bool> [-tick_rate=<hz>] "
+                 "[-fps=<hz>] [-trace=<file>]\n"
+                 "                [-level=<file>] [-paddle_speed=<px/s>] "
+                 "[-paddle_accel=<px/s^2>]\n"
+                 "                [-record=<file> | -replay=<file> "
+                 "[-replay_speed=realtime|max]]\n"
+                 "                [-stress_balls=<n>] [-scores=<file>]\n";
     exit(1);
 }
 
+static uint32_t parse_rate(const char* value)
+{
+    char* end;
+    unsigned long rate = strtoul(value, &end, 10);
+    if (*end != '\0' || rate > 10000) usage();
+    return rate;
+}
+
+static uint32_t parse_count(const char* value)
+{
+    char* end;
+    unsigned long count = strtoul(value, &end, 10);
+    if (*end != '\0' || count > 1000000) usage();
+    return count;
+}
+
+static float parse_positive(const char* value)
+{
+    char* end;
+    float number = strtof(value, &end);
+    if (*end != '\0' || !(number > 0.0f)) usage();
+    return number;
+}
+
 int main(int argc, char** argv)
 {
-    if (argc != 2)
+    if (argc < 2)
         usage();
-    bool print_fps = strcmp(argv[1], "-print_fps=true") == 0 ? true : false;
+
+    bool     print_fps = false;
+    uint32_t tick_rate = Simulation::default_tick_rate;
+    uint32_t fps       = default_fps; // zero means uncapped (vsync only)
+    float    paddle_speed = Simulation::default_paddle_speed;
+    float    paddle_accel = Simulation::default_paddle_accel;
+    const char* trace_path = nullptr; // where to write the profile at exit
+    const char* level_path = nullptr; // see `breakout_levelgen'
+    const char* record_path = nullptr;
+    const char* replay_path = nullptr;
+    bool        max_speed   = false; // replay without rendering or waiting
+    uint32_t    stress_balls = 0; // extra balls, not recorded in replays
+    const char* scores_path = "highscores.log"; // see `scores.hh'
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-print_fps=true") == 0)
+            print_fps = true;
+        else if (strcmp(argv[i], "-print_fps=false") == 0)
+            print_fps = false;
+        else if (strncmp(argv[i], "-tick_rate=", 11) == 0)
+            tick_rate = parse_rate(argv[i] + 11);
+        else if (strncmp(argv[i], "-fps=", 5) == 0)
+            fps = parse_rate(argv[i] + 5);
+        else if (strncmp(argv[i], "-paddle_speed=", 14) == 0)
+            paddle_speed = parse_positive(argv[i] + 14);
+        else if (strncmp(argv[i], "-paddle_accel=", 14) == 0)
+            paddle_accel = parse_positive(argv[i] + 14);
+        else if (strncmp(argv[i], "-trace=", 7) == 0 && argv[i][7] != '\0')
+            trace_path = argv[i] + 7;
+        else if (strncmp(argv[i], "-level=", 7) == 0 && argv[i][7] != '\0')
+            level_path = argv[i] + 7;
+        else if (strncmp(argv[i], "-record=", 8) == 0 && argv[i][8] != '\0')
+            record_path = argv[i] + 8;
+        else if (strncmp(argv[i], "-replay=", 8) == 0 && argv[i][8] != '\0')
+            replay_path = argv[i] + 8;
+        else if (strcmp(argv[i], "-replay_speed=realtime") == 0)
+            max_speed = false;
+        else if (strcmp(argv[i], "-replay_speed=max") == 0)
+            max_speed = true;
+        else if (strncmp(argv[i], "-stress_balls=", 14) == 0)
+            stress_balls = parse_count(argv[i] + 14);
+        else if (strncmp(argv[i], "-scores=", 8) == 0 && argv[i][8] != '\0')
+            scores_path = argv[i] + 8;
+        else
+            usage();
+    }
+    if (tick_rate == 0 || (record_path && replay_path)) usage();
+    if (stress_balls && (record_path || replay_path)) usage();
+
+    // mapped, not read, so even huge levels open right away
+    level::Map map;
+    if (level_path) {
+        if (const char* error = map.open(level_path)) {
+            std::cerr << "error: " << error << '\n';
+            return 1;
+        }
+    }
+
+    // a replay only matches with the settings (and level) it was recorded with
+    replay::Player player;
+    if (replay_path) {
+        if (const char* error = player.load(replay_path)) {
+            std::cerr << "error: " << error << '\n';
+            return 1;
+        }
+        tick_rate    = player.get_settings().tick_rate;
+        paddle_speed = player.get_settings().paddle_speed;
+        paddle_accel = player.get_settings().paddle_accel;
+    }
 
     SDL_SetEventFilter(
             [](void*, SDL_Event* event) -> int
@@ -27,77 +139,157 @@ int main(int argc, char** argv)
                 case SDL_QUIT:
                     return 1;
                 case SDL_KEYDOWN:
+                case SDL_KEYUP:
                     return 1;
                 case SDL_MOUSEBUTTONDOWN:
+                case SDL_RENDER_TARGETS_RESET:
+                case SDL_WINDOWEVENT: // wakes up the idle loop to redraw
+                case SDL_USEREVENT:   // the session published a snapshot
                     return 1;
                 default:
                     return 0;
                 }
             }, nullptr);
 
-    Game     game(print_fps);
-    bool     quit        = false;
-    uint32_t current_fps = fps;
+    Game       game(print_fps, tick_rate, level_path ? &map : nullptr);
+    Session&   session     = game.get_session();
+    InputQueue& input      = game.get_input();
+    bool       quit        = false;
+    uint32_t   current_fps = 0;
+    session.set_paddle_motion(paddle_speed, paddle_accel);
+    session.spawn_balls(stress_balls);
+
+    if (record_path) {
+        replay::Settings settings = { tick_rate, paddle_speed, paddle_accel };
+        if (const char* error = session.record(record_path, settings)) {
+            std::cerr << "error: " << error << '\n';
+            return 1;
+        }
+    }
+    if (replay_path) session.set_replay(std::move(player));
+
+    // a replayed game was scored when it was played, a stress test isn't
+    if (!replay_path && stress_balls == 0) {
+        if (const char* error = game.get_scores().open(scores_path))
+            std::cerr << "unable to keep high scores: " << error << '\n';
+    }
+
+    if (replay_path && max_speed) {
+        uint64_t start = SDL_GetPerformanceCounter();
+        session.run_replay();
+        double seconds = (SDL_GetPerformanceCounter() - start)
+                         / (double)SDL_GetPerformanceFrequency();
+        uint64_t tick  = session.get_tick();
+        printf("replayed %llu ticks in %.3f s (%.0f ticks/s)\n",
+               (unsigned long long)tick, seconds,
+               seconds > 0.0 ? tick / seconds : 0.0);
+        quit = true;
+    } else {
+        session.start();
+    }
+
+    const double counter_freq = SDL_GetPerformanceFrequency();
+    const double frame_time   = fps ? 1.0 / fps : 0.0;
+    uint64_t     last_time    = SDL_GetPerformanceCounter();
+
+    double idle_seconds = 0.0, idle_cpu = 0.0; // wall and CPU time while idle
+    bool   redraw       = true; // draw the next idle frame
+
+    auto handle = [&](const SDL_Event& event) {
+        if (event.type == SDL_RENDER_TARGETS_RESET) // cached layers lost
+            game.reset_layers();
+        else if (!replay_path && event.type == SDL_MOUSEBUTTONDOWN &&
+                 event.button.button == SDL_BUTTON_LEFT)
+            game.left_button_press(event.button.x, event.button.y);
+        if (!input.handle(event))
+            quit = true;
+    };
+
+    Profiler& profiler = game.get_profiler();
+    profiler.set_budget(fps ? frame_time : 1.0 / default_fps);
     while (!quit) {
-        uint32_t start_time = SDL_GetTicks();
-        SDL_Event event;
-        while (SDL_PollEvent(&event)) {
-            switch (event.type) {
-            case SDL_QUIT:
-                quit = true;
-                break;
-            case SDL_KEYDOWN:
-                {
-                    int pressed_key = event.key.keysym.scancode;
-                    switch (pressed_key) {
-                    case SDL_SCANCODE_LEFT:
-                        game.update_x(Game::Direction::LEFT);
-                        break;
-                    case SDL_SCANCODE_RIGHT:
-                        game.update_x(Game::Direction::RIGHT);
-                        break;
-                    case SDL_SCANCODE_Q:
-                        quit = true;
-                        break;
-                    case SDL_SCANCODE_P:
-                        game.toggle_pause();
-                        break;
-                    case SDL_SCANCODE_SPACE:
-                        game.start();
-                        break;
-                    default:
-                        game.key_press();
-                        game.start_ball();
-                        break;
-                    }
-                }
-                break;
-            case SDL_MOUSEBUTTONDOWN:
-                {
-                    int pressed_button = event.button.button;
-                    int32_t x = event.button.x;
-                    int32_t y = event.button.y;
-                    switch (pressed_button) {
-                    case SDL_BUTTON_LEFT:
-                        game.left_button_press(x, y);
-                        break;
-                    }
-                }
-            default:
-                break;
+        // a replay needs the ticks to go on, it never idles
+        if (!replay_path && !game.is_animated()) {
+            if (!game.update()) break; // the session is over
+            if (game.is_animated()) continue; // it just got going
+
+            uint64_t     idle_start = SDL_GetPerformanceCounter();
+            std::clock_t cpu_start  = std::clock();
+            if (redraw) game.render();
+            redraw = false;
+
+            /* Input, window (e.g. exposed) or any other event: draw again.
+             * The session applies commands right away while idle and sends
+             * an event once it published the result.
+             */
+            SDL_Event event;
+            if (SDL_WaitEventTimeout(&event, idle_timeout_ms)) {
+                handle(event);
+                while (SDL_PollEvent(&event)) handle(event);
+                redraw = true;
             }
+
+            last_time     = SDL_GetPerformanceCounter();
+            idle_seconds += (last_time - idle_start) / counter_freq;
+            idle_cpu     += (double)(std::clock() - cpu_start) / CLOCKS_PER_SEC;
+            continue;
         }
-        game.update();
+        redraw = true; // entering the idle state draws it once
+
+        profiler.begin_frame();
+        uint64_t start_time = SDL_GetPerformanceCounter();
+        double   elapsed    = (start_time - last_time) / counter_freq;
+        last_time   = start_time;
+        current_fps = elapsed > 0.0 ? (uint32_t)(1.0 / elapsed + 0.5) : 0;
+
+        profiler.begin(Profiler::Phase::EVENTS);
+        SDL_Event event;
+        while (SDL_PollEvent(&event)) handle(event);
+        profiler.end(Profiler::Phase::EVENTS);
+
+        // the ticks themselves run on the session's thread
+        profiler.begin(Profiler::Phase::UPDATE);
+        if (!game.update()) quit = true;
+        profiler.end(Profiler::Phase::UPDATE);
+
         game.update_current_fps(current_fps);
         game.render();
 
-        uint32_t end_time = SDL_GetTicks();
-        uint32_t delta = end_time - start_time;
-        current_fps = 1000 / (delta > 0 ? delta : 1);
-        if (delta < ms_per_frame) {
-            SDL_Delay(ms_per_frame - delta);
-            current_fps = 60;
+        // don't spin faster than the display rate, vsync should do the rest
+        profiler.begin(Profiler::Phase::SLEEP);
+        double busy = (SDL_GetPerformanceCounter() - start_time) / counter_freq;
+        if (busy < frame_time)
+            SDL_Delay((uint32_t)((frame_time - busy) * 1000.0));
+        profiler.end(Profiler::Phase::SLEEP);
+        profiler.end_frame();
+    }
+
+    session.stop();
+    session.finish();
+    if (replay_path) {
+        uint64_t tick    = session.get_tick();
+        uint64_t checked = session.get_checked();
+        if (session.is_diverged()) {
+            std::cerr << "replay diverged from the log at or before tick "
+                      << tick << " (" << checked << " checkpoints matched)\n";
+            return 1;
         }
+        if (session.is_replay_done())
+            printf("replay matched the log (%llu checkpoints, %llu ticks)\n",
+                   (unsigned long long)checked, (unsigned long long)tick);
+        else
+            printf("replay stopped at tick %llu\n", (unsigned long long)tick);
+    }
+
+    if (print_fps && !max_speed) {
+        profiler.print_summary();
+        printf("idle     %9.3f s, %.3f s CPU (%.2f%%)\n", idle_seconds,
+               idle_cpu, idle_seconds > 0.0 ? idle_cpu / idle_seconds * 100.0
+                                            : 0.0);
+    }
+    if (trace_path) {
+        if (const char* error = profiler.write_trace(trace_path))
+            std::cerr << "error: " << error << '\n';
     }
 
     return 0;
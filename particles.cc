@@ -0,0 +1,239 @@
+#include <algorithm>
+#include <cmath>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define PARTICLES_X86 1
+#endif
+
+#include "particles.hh"
+
+namespace {
+    enum class Isa { SCALAR, SSE2, AVX };
+}
+
+static Isa detect_isa(void)
+{
+#ifdef PARTICLES_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx"))  return Isa::AVX;
+    if (__builtin_cpu_supports("sse2")) return Isa::SSE2;
+#endif
+    return Isa::SCALAR;
+}
+
+static const Isa best_isa = detect_isa();
+static Isa       isa      = best_isa;
+
+static uint32_t round_up(uint32_t n)
+{
+    return (n + 7) & ~7u;
+}
+
+/* All variants of the integration do the same for the particles [0, n): fall
+ * for `dt' seconds (velocity first, then position) and age. `n' is a multiple
+ * of 8, the padding behind the live particles is moved along harmlessly.
+ */
+static void step_scalar(float* xs, float* ys, const float* vxs, float* vys,
+                        float* lives, uint32_t n, float dt)
+{
+    const float dv = ParticlePool::gravity * dt;
+    for (uint32_t i = 0; i < n; i++) {
+        vys[i]   += dv;
+        xs[i]    += vxs[i] * dt;
+        ys[i]    += vys[i] * dt;
+        lives[i] -= dt;
+    }
+}
+
+// The first particle in [from, n) with no life left, or `n'.
+static uint32_t find_dead_scalar(const float* lives, uint32_t from, uint32_t n)
+{
+    for (; from < n; from++)
+        if (lives[from] <= 0.0f) return from;
+    return n;
+}
+
+#ifdef PARTICLES_X86
+__attribute__((target("avx")))
+static void step_avx(float* xs, float* ys, const float* vxs, float* vys,
+                     float* lives, uint32_t n, float dt)
+{
+    const __m256 vdt = _mm256_set1_ps(dt);
+    const __m256 vdv = _mm256_set1_ps(ParticlePool::gravity * dt);
+    for (uint32_t i = 0; i < n; i += 8) {
+        __m256 vy = _mm256_add_ps(_mm256_loadu_ps(vys + i), vdv);
+        __m256 x  = _mm256_add_ps(_mm256_loadu_ps(xs + i),
+                                  _mm256_mul_ps(_mm256_loadu_ps(vxs + i), vdt));
+        __m256 y  = _mm256_add_ps(_mm256_loadu_ps(ys + i),
+                                  _mm256_mul_ps(vy, vdt));
+        _mm256_storeu_ps(vys + i, vy);
+        _mm256_storeu_ps(xs + i, x);
+        _mm256_storeu_ps(ys + i, y);
+        _mm256_storeu_ps(lives + i,
+                         _mm256_sub_ps(_mm256_loadu_ps(lives + i), vdt));
+    }
+}
+
+// Most particles are alive, so 8 of them are checked with one compare.
+__attribute__((target("avx")))
+static uint32_t find_dead_avx(const float* lives, uint32_t from, uint32_t n)
+{
+    const __m256 zero = _mm256_setzero_ps();
+    for (; from + 8 <= n; from += 8) {
+        __m256   dead = _mm256_cmp_ps(_mm256_loadu_ps(lives + from), zero,
+                                      _CMP_LE_OQ);
+        uint32_t mask = _mm256_movemask_ps(dead);
+        if (mask) return from + __builtin_ctz(mask);
+    }
+    return find_dead_scalar(lives, from, n);
+}
+
+__attribute__((target("sse2")))
+static void step_sse2(float* xs, float* ys, const float* vxs, float* vys,
+                      float* lives, uint32_t n, float dt)
+{
+    const __m128 vdt = _mm_set1_ps(dt);
+    const __m128 vdv = _mm_set1_ps(ParticlePool::gravity * dt);
+    for (uint32_t i = 0; i < n; i += 4) {
+        __m128 vy = _mm_add_ps(_mm_loadu_ps(vys + i), vdv);
+        __m128 x  = _mm_add_ps(_mm_loadu_ps(xs + i),
+                               _mm_mul_ps(_mm_loadu_ps(vxs + i), vdt));
+        __m128 y  = _mm_add_ps(_mm_loadu_ps(ys + i), _mm_mul_ps(vy, vdt));
+        _mm_storeu_ps(vys + i, vy);
+        _mm_storeu_ps(xs + i, x);
+        _mm_storeu_ps(ys + i, y);
+        _mm_storeu_ps(lives + i, _mm_sub_ps(_mm_loadu_ps(lives + i), vdt));
+    }
+}
+
+__attribute__((target("sse2")))
+static uint32_t find_dead_sse2(const float* lives, uint32_t from, uint32_t n)
+{
+    const __m128 zero = _mm_setzero_ps();
+    for (; from + 4 <= n; from += 4) {
+        uint32_t mask = _mm_movemask_ps(_mm_cmple_ps(_mm_loadu_ps(lives
+                                                                  + from),
+                                                     zero));
+        if (mask) return from + __builtin_ctz(mask);
+    }
+    return find_dead_scalar(lives, from, n);
+}
+#endif /* PARTICLES_X86 */
+
+static uint32_t find_dead(const float* lives, uint32_t from, uint32_t n)
+{
+#ifdef PARTICLES_X86
+    if (isa == Isa::AVX)  return find_dead_avx(lives, from, n);
+    if (isa == Isa::SSE2) return find_dead_sse2(lives, from, n);
+#endif
+    return find_dead_scalar(lives, from, n);
+}
+
+// Only meant for benchmarks, to compare against the plain scalar code.
+void ParticlePool::set_vectorized(bool on)
+{
+    isa = on ? best_isa : Isa::SCALAR;
+}
+
+// Everything is allocated here, for `capacity' particles.
+ParticlePool::ParticlePool(uint32_t capacity)
+    : capacity(capacity), xs(round_up(capacity)), ys(round_up(capacity)),
+      vxs(round_up(capacity)), vys(round_up(capacity)),
+      lives(round_up(capacity)), fades(capacity), sizes(capacity),
+      colors(capacity), vertices(4 * capacity), indices(6 * capacity)
+{
+    static const int quad[6] = { 0, 1, 2, 0, 2, 3 }; // two triangles
+    for (uint32_t i = 0; i < capacity; i++)
+        for (uint32_t k = 0; k < 6; k++)
+            indices[6*i + k] = 4*i + quad[k];
+}
+
+// xorshift32, as a float in [0, 1)
+float ParticlePool::next_random(void)
+{
+    seed ^= seed << 13;
+    seed ^= seed >> 17;
+    seed ^= seed << 5;
+    return (seed >> 8) * (1.0f / 16777216.0f);
+}
+
+/* Add `n' particles somewhere in `area', flying off in all directions (but
+ * mostly up) at up to `spray.speed'. Those that don't fit anymore are dropped.
+ */
+void ParticlePool::spawn(const SDL_Rect& area, uint32_t n, const Spray& spray)
+{
+    for (uint32_t k = 0; k < n && count < capacity; k++, count++) {
+        float angle = next_random() * 6.2831853f;
+        float speed = spray.speed * (0.25f + 0.75f * next_random());
+        float life  = spray.lifetime * (0.5f + 0.5f * next_random());
+
+        xs[count]     = area.x + next_random() * area.w;
+        ys[count]     = area.y + next_random() * area.h;
+        vxs[count]    = cosf(angle) * speed;
+        vys[count]    = sinf(angle) * speed - spray.speed * 0.5f;
+        lives[count]  = life;
+        fades[count]  = 1.0f / life;
+        sizes[count]  = spray.size * (0.25f + 0.25f * next_random());
+        colors[count] = spray.color;
+    }
+}
+
+// Swap the last particle into the place of particle `i'.
+void ParticlePool::remove(uint32_t i)
+{
+    count--;
+    xs[i]     = xs[count];
+    ys[i]     = ys[count];
+    vxs[i]    = vxs[count];
+    vys[i]    = vys[count];
+    lives[i]  = lives[count];
+    fades[i]  = fades[count];
+    sizes[i]  = sizes[count];
+    colors[i] = colors[count];
+}
+
+// Move all particles by `dt' seconds and drop the ones that expired.
+void ParticlePool::update(float dt)
+{
+    uint32_t n = round_up(count);
+#ifdef PARTICLES_X86
+    if (isa == Isa::AVX)
+        step_avx(xs.data(), ys.data(), vxs.data(), vys.data(), lives.data(),
+                 n, dt);
+    else if (isa == Isa::SSE2)
+        step_sse2(xs.data(), ys.data(), vxs.data(), vys.data(), lives.data(),
+                  n, dt);
+    else
+#endif
+        step_scalar(xs.data(), ys.data(), vxs.data(), vys.data(),
+                    lives.data(), n, dt);
+
+    // the particle swapped in might be expired as well, so check `i' again
+    for (uint32_t i = find_dead(lives.data(), 0, count); i < count;
+         i = find_dead(lives.data(), i, count))
+        remove(i);
+}
+
+/* Fill the vertex buffer with a quad per particle, `camera' pixels up and
+ * fading out towards the end of its life. Returns the number of indices to
+ * draw (with `get_vertices()' and `get_indices()').
+ */
+uint32_t ParticlePool::build(int32_t camera)
+{
+    for (uint32_t i = 0; i < count; i++) {
+        float x0 = xs[i] - sizes[i], x1 = xs[i] + sizes[i];
+        float y0 = ys[i] - sizes[i] - camera;
+        float y1 = ys[i] + sizes[i] - camera;
+
+        SDL_Color c = colors[i];
+        c.a = c.a * std::min(1.0f, lives[i] * fades[i]);
+
+        SDL_Vertex* v = &vertices[4 * i];
+        v[0] = { { x0, y0 }, c, { 0.0f, 0.0f } };
+        v[1] = { { x1, y0 }, c, { 0.0f, 0.0f } };
+        v[2] = { { x1, y1 }, c, { 0.0f, 0.0f } };
+        v[3] = { { x0, y1 }, c, { 0.0f, 0.0f } };
+    }
+    return count * 6;
+}
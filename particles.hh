@@ -0,0 +1,64 @@
+#ifndef _PARTICLES_H_
+#define _PARTICLES_H_
+
+#include <cstdint>
+#include <SDL2/SDL.h>
+#include <vector>
+
+/* `ParticlePool' animates short-lived debris and sparks (e.g. of a broken
+ * brick). All of its memory is allocated up front for a fixed number of
+ * particles: spawning more than fit drops the extra ones, and particles that
+ * expire are swapped out with the last one, so neither ever allocates.
+ *
+ * Particles are kept as a structure of arrays and moved with SIMD, several at
+ * a time. For drawing, every particle becomes a quad of one triangle list, so
+ * all of them take a single `SDL_RenderGeometry()' call (see `build()').
+ */
+class ParticlePool {
+public:
+    // How a burst of particles looks and moves, see `spawn()'.
+    struct Spray {
+        SDL_Color color;
+        float     speed;    // the fastest, in pixels per second
+        float     lifetime; // the longest, in seconds
+        float     size;     // edge length in pixels
+    };
+
+    static constexpr float gravity = 900.0f; // pixels per second squared
+private:
+    uint32_t capacity;
+    uint32_t count = 0;
+    uint32_t seed  = 0x9e3779b9; // see `next_random()'
+
+    // one element per particle, padded to a multiple of 8 for SIMD
+    std::vector<float>     xs, ys;   // midpoint
+    std::vector<float>     vxs, vys; // pixels per second
+    std::vector<float>     lives;    // seconds left
+    std::vector<float>     fades;    // 1 / lifetime, to fade out
+    std::vector<float>     sizes;    // half the edge length
+    std::vector<SDL_Color> colors;
+
+    std::vector<SDL_Vertex> vertices; // 4 per particle
+    std::vector<int>        indices;  // 6 per particle, never change
+
+    float next_random(void);
+    void  remove(uint32_t);
+public:
+    explicit ParticlePool(uint32_t);
+    ParticlePool(const ParticlePool&) = delete;
+    ParticlePool& operator=(const ParticlePool&) = delete;
+
+    void     spawn(const SDL_Rect&, uint32_t, const Spray&);
+    void     update(float);
+    uint32_t build(int32_t);
+    void     clear(void) { count = 0; }
+
+    static void set_vectorized(bool);
+
+    uint32_t          get_count(void) const    { return count; }
+    uint32_t          get_capacity(void) const { return capacity; }
+    const SDL_Vertex* get_vertices(void) const { return vertices.data(); }
+    const int*        get_indices(void) const  { return indices.data(); }
+};
+
+#endif /* _PARTICLES_H_ */
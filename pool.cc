@@ -0,0 +1,80 @@
+#include <algorithm>
+#include <thread>
+
+#include "pool.hh"
+
+// At least one worker, `0' is one per core.
+WorkPool::WorkPool(uint32_t n)
+    : workers(n ? n : std::max(1u, std::thread::hardware_concurrency())),
+      ranges(workers), stats(workers)
+{
+}
+
+/* Run `fn' for every task from 0 to `tasks' - 1 and wait for all of them.
+ * The calling thread is worker 0, the others are started for the batch.
+ */
+void WorkPool::run(uint32_t tasks, task_fn fn, void* data)
+{
+    for (uint32_t i = 0; i < workers; i++) {
+        ranges[i].begin = (uint64_t)tasks * i / workers;
+        ranges[i].end   = (uint64_t)tasks * (i + 1) / workers;
+        stats[i]        = Stats();
+    }
+
+    std::vector<std::thread> threads;
+    for (uint32_t i = 1; i < workers; i++)
+        threads.emplace_back(&WorkPool::work, this, i, fn, data);
+    work(0, fn, data);
+    for (std::thread& thread: threads) thread.join();
+}
+
+/* Tasks are never added while the batch runs, only moved between ranges, so
+ * a worker that finds nothing left anywhere is done.
+ */
+void WorkPool::work(uint32_t worker, task_fn fn, void* data)
+{
+    uint32_t task;
+    while (take(worker, &task) || steal(worker, &task)) {
+        fn(task, worker, data);
+        stats[worker].tasks++;
+    }
+}
+
+bool WorkPool::take(uint32_t worker, uint32_t* task)
+{
+    Range& own = ranges[worker];
+    std::lock_guard<std::mutex> lock(own.mutex);
+    if (own.begin == own.end) return false;
+    *task = own.begin++;
+    return true;
+}
+
+/* Take the back half (rounded up) of the first range that isn't empty,
+ * starting with the next worker's. The first of the stolen tasks is run right
+ * away, the rest become this worker's (empty) range.
+ */
+bool WorkPool::steal(uint32_t worker, uint32_t* task)
+{
+    for (uint32_t i = 1; i < workers; i++) {
+        Range&   victim = ranges[(worker + i) % workers];
+        uint32_t begin, end;
+        {
+            std::lock_guard<std::mutex> lock(victim.mutex);
+            if (victim.begin == victim.end) continue;
+            begin = victim.begin + (victim.end - victim.begin) / 2;
+            end   = victim.end;
+            victim.end = begin;
+        }
+
+        Range& own = ranges[worker];
+        {
+            std::lock_guard<std::mutex> lock(own.mutex);
+            own.begin = begin + 1;
+            own.end   = end;
+        }
+        stats[worker].steals++;
+        *task = begin;
+        return true;
+    }
+    return false;
+}
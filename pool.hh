@@ -0,0 +1,49 @@
+#ifndef _POOL_H_
+#define _POOL_H_
+
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+/* Runs a batch of independent tasks, numbered from 0, on a fixed number of
+ * threads. The tasks are dealt out up front as one contiguous range per
+ * worker; a worker takes tasks from the front of its own range, and once
+ * that's empty it steals the back half of the range of another worker. So
+ * workers that drew short tasks help out instead of idling, while tasks are
+ * handed out without any shared counter all workers would fight over.
+ * Each range has its own lock, which the owner only shares with thieves.
+ */
+class WorkPool {
+public:
+    typedef void (*task_fn)(uint32_t task, uint32_t worker, void* data);
+
+    // Every worker updates its own, each on a cache line of its own.
+    struct alignas(64) Stats {
+        uint64_t tasks  = 0; // run by the worker
+        uint64_t steals = 0; // successful ones
+    };
+private:
+    struct alignas(64) Range {
+        std::mutex mutex;
+        uint32_t   begin = 0, end = 0; // tasks not taken yet
+    };
+
+    const uint32_t     workers;
+    std::vector<Range> ranges;
+    std::vector<Stats> stats;
+
+    void work(uint32_t, task_fn, void*);
+    bool take(uint32_t, uint32_t*);
+    bool steal(uint32_t, uint32_t*);
+public:
+    explicit WorkPool(uint32_t);
+    WorkPool(const WorkPool&) = delete;
+    WorkPool& operator=(const WorkPool&) = delete;
+
+    void run(uint32_t, task_fn, void*);
+
+    uint32_t                  get_workers(void) const { return workers; }
+    const std::vector<Stats>& get_stats(void) const   { return stats; }
+};
+
+#endif /* _POOL_H_ */
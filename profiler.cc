@@ -0,0 +1,147 @@
+#include <algorithm>
+#include <cstdio>
+#include <SDL2/SDL.h>
+
+#include "profiler.hh"
+
+Profiler::Profiler(void)
+    : freq(SDL_GetPerformanceFrequency()), budget(1.0 / 60.0)
+{
+    begin_frame();
+}
+
+const char* Profiler::get_name(Phase phase)
+{
+    switch (phase) {
+    case Phase::EVENTS:  return "events";
+    case Phase::UPDATE:  return "update";
+    case Phase::RENDER:  return "render";
+    case Phase::PRESENT: return "present";
+    case Phase::SLEEP:   return "sleep";
+    case Phase::FRAME:   return "frame";
+    }
+    return "unknown";
+}
+
+// Phases that aren't reached during a frame (e.g. no update) count as zero.
+void Profiler::begin_frame(void)
+{
+    for (uint32_t p = 0; p < num_phases; p++)
+        current.start[p] = current.end[p] = 0;
+    begin(Phase::FRAME);
+}
+
+void Profiler::end_frame(void)
+{
+    end(Phase::FRAME);
+    samples[next] = current;
+    next  = (next + 1) % capacity;
+    count = std::min(count + 1, capacity);
+}
+
+// The sample of the frame `age' frames ago (0 is the last complete frame).
+const Profiler::Sample& Profiler::get_sample(uint32_t age) const
+{
+    return samples[(next + capacity - 1 - age) % capacity];
+}
+
+// Duration of `phase' in the frame `age' frames ago, in seconds.
+double Profiler::get_duration(uint32_t age, Phase phase) const
+{
+    if (age >= count) return 0.0;
+    const Sample& s = get_sample(age);
+    int p = (int)phase;
+    if (s.end[p] <= s.start[p]) return 0.0;
+    return (s.end[p] - s.start[p]) / freq;
+}
+
+/* How long the frame `age' frames ago actually worked, i.e. without waiting
+ * for the frame cap. This is what has to fit into the budget.
+ */
+double Profiler::get_busy(uint32_t age) const
+{
+    return get_duration(age, Phase::FRAME) - get_duration(age, Phase::SLEEP);
+}
+
+Profiler::Stats Profiler::get_stats(Phase phase) const
+{
+    return percentiles([&](uint32_t age) { return get_duration(age, phase); });
+}
+
+Profiler::Stats Profiler::get_busy_stats(void) const
+{
+    return percentiles([&](uint32_t age) { return get_busy(age); });
+}
+
+// `seconds(age)' gives the value of the frame `age' frames ago.
+template <typename F>
+Profiler::Stats Profiler::percentiles(F seconds) const
+{
+    Stats stats;
+    if (count == 0) return stats;
+
+    double ms[capacity]; // on the stack, it's drawn every frame
+    for (uint32_t i = 0; i < count; i++) ms[i] = seconds(i) * 1000.0;
+    std::sort(ms, ms + count);
+
+    auto percentile = [&](double p) {
+        return ms[std::min<uint32_t>(count - 1, p * count)];
+    };
+    stats.p50 = percentile(0.50);
+    stats.p95 = percentile(0.95);
+    stats.p99 = percentile(0.99);
+    stats.max = ms[count - 1];
+    return stats;
+}
+
+void Profiler::print_summary(void) const
+{
+    printf("%-8s %9s %9s %9s %9s   (ms, last %u frames)\n", "phase", "p50",
+           "p95", "p99", "max", count);
+    for (uint32_t p = 0; p < num_phases; p++) {
+        Stats s = get_stats((Phase)p);
+        printf("%-8s %9.3f %9.3f %9.3f %9.3f\n", get_name((Phase)p), s.p50,
+               s.p95, s.p99, s.max);
+    }
+    Stats s = get_busy_stats();
+    printf("%-8s %9.3f %9.3f %9.3f %9.3f   (budget %.3f)\n", "busy", s.p50,
+           s.p95, s.p99, s.max, budget * 1000.0);
+}
+
+/* Write all frames in the ring buffer as Chrome trace events ("complete"
+ * events with a start and a duration in microseconds). Frames that were busy
+ * for longer than the budget are named "frame (over budget)", so they're easy
+ * to find. Returns an error message or `nullptr'.
+ */
+const char* Profiler::write_trace(const char* path) const
+{
+    FILE* file = fopen(path, "w");
+    if (!file) return "unable to open the trace file";
+
+    uint64_t origin = count ? get_sample(count - 1).start[(int)Phase::FRAME]
+                            : 0;
+    bool     first  = true;
+    fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    for (uint32_t age = count; age-- > 0;) {
+        const Sample& s = get_sample(age);
+        for (uint32_t p = 0; p < num_phases; p++) {
+            if (s.end[p] <= s.start[p]) continue;
+
+            const char* name = get_name((Phase)p);
+            double      dur  = (s.end[p] - s.start[p]) / freq;
+            if ((Phase)p == Phase::FRAME && get_busy(age) > budget)
+                name = "frame (over budget)";
+            fprintf(file,
+                    "%s{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":1,"
+                    "\"ts\":%.3f,\"dur\":%.3f}",
+                    first ? "" : ",\n", name,
+                    (s.start[p] - origin) / freq * 1e6, dur * 1e6);
+            first = false;
+        }
+    }
+    fprintf(file, "\n]}\n");
+
+    bool failed = ferror(file);
+    if (fclose(file) != 0 || failed) return "unable to write the trace file";
+    return nullptr;
+}
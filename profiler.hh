@@ -0,0 +1,63 @@
+#ifndef _PROFILER_H_
+#define _PROFILER_H_
+
+#include <cstdint>
+#include <SDL2/SDL.h>
+
+/* The `Profiler' times the phases of each frame with the performance counter
+ * and keeps the last `capacity' frames in a ring buffer. From those, it
+ * reports percentiles per phase and it can write them as a Chrome trace (open
+ * it in `chrome://tracing' or https://ui.perfetto.dev).
+ * Every phase is timed at most once per frame (the last `begin()' wins).
+ */
+class Profiler {
+public:
+    enum class Phase : uint8_t {
+        EVENTS, UPDATE, RENDER, PRESENT, SLEEP,
+        FRAME // the whole frame, see `begin_frame()'
+    };
+    static constexpr uint32_t num_phases = 6;
+    static constexpr uint32_t capacity   = 512; // frames
+
+    struct Stats { // all in milliseconds
+        double p50 = 0.0, p95 = 0.0, p99 = 0.0, max = 0.0;
+    };
+private:
+    struct Sample {
+        uint64_t start[num_phases];
+        uint64_t end[num_phases];
+    };
+
+    Sample   samples[capacity];
+    Sample   current;
+    uint32_t count = 0; // valid samples, at most `capacity'
+    uint32_t next  = 0; // where the next frame goes
+    double   freq;      // performance counter ticks per second
+    double   budget;    // seconds per frame
+
+    const Sample& get_sample(uint32_t) const;
+    template <typename F>
+    Stats         percentiles(F) const;
+public:
+    Profiler(void);
+
+    void begin_frame(void);
+    void end_frame(void);
+    void begin(Phase p) { current.start[(int)p] = SDL_GetPerformanceCounter(); }
+    void end(Phase p)   { current.end[(int)p]   = SDL_GetPerformanceCounter(); }
+
+    Stats       get_stats(Phase) const;
+    Stats       get_busy_stats(void) const;
+    double      get_duration(uint32_t, Phase) const;
+    double      get_busy(uint32_t) const;
+    void        print_summary(void) const;
+    const char* write_trace(const char*) const;
+
+    void     set_budget(double seconds) { budget = seconds; }
+    double   get_budget(void) const     { return budget; }
+    uint32_t get_count(void) const      { return count; }
+
+    static const char* get_name(Phase);
+};
+
+#endif /* _PROFILER_H_ */
@@ -0,0 +1,153 @@
+#include <bit>
+#include <cstring>
+
+#include "replay.hh"
+
+static const char    magic[4] = { 'B', 'R', 'K', 'L' };
+static const uint8_t version  = 2;
+
+// FNV-1a over the 8 bytes of `value', starting from `hash'.
+uint64_t replay::mix_hash(uint64_t hash, uint64_t value)
+{
+    for (uint32_t i = 0; i < 8; i++) {
+        hash ^= (value >> (8 * i)) & 0xff;
+        hash *= 0x100000001b3ull;
+    }
+    return hash;
+}
+
+static void put_u64(FILE* file, uint64_t value, uint32_t bytes)
+{
+    for (uint32_t i = 0; i < bytes; i++) fputc((value >> (8 * i)) & 0xff, file);
+}
+
+static bool get_u64(FILE* file, uint64_t* value, uint32_t bytes)
+{
+    *value = 0;
+    for (uint32_t i = 0; i < bytes; i++) {
+        int c = fgetc(file);
+        if (c == EOF) return false;
+        *value |= (uint64_t)c << (8 * i);
+    }
+    return true;
+}
+
+// 7 bits per byte, the high bit tells whether more bytes follow.
+static void put_varint(FILE* file, uint64_t value)
+{
+    while (value >= 0x80) {
+        fputc((value & 0x7f) | 0x80, file);
+        value >>= 7;
+    }
+    fputc(value, file);
+}
+
+static bool get_varint(FILE* file, uint64_t* value)
+{
+    *value = 0;
+    for (uint32_t shift = 0; shift < 64; shift += 7) {
+        int c = fgetc(file);
+        if (c == EOF) return false;
+        *value |= (uint64_t)(c & 0x7f) << shift;
+        if (!(c & 0x80)) return true;
+    }
+    return false;
+}
+
+// Start a new log at `path' for a session with the given settings.
+const char* replay::Recorder::open(const char* path, const Settings& settings)
+{
+    close();
+    file = fopen(path, "wb");
+    if (!file) return "unable to open the input log for writing";
+
+    fwrite(magic, 1, sizeof(magic), file);
+    fputc(version, file);
+    put_u64(file, settings.tick_rate, 4);
+    put_u64(file, std::bit_cast<uint32_t>(settings.paddle_speed), 4);
+    put_u64(file, std::bit_cast<uint32_t>(settings.paddle_accel), 4);
+    last_tick = 0;
+    return nullptr;
+}
+
+// Entries must be recorded in the order of their ticks.
+void replay::Recorder::record(const Entry& entry)
+{
+    if (!file) return;
+
+    put_varint(file, entry.tick - last_tick);
+    fputc((uint8_t)entry.command, file);
+    if (entry.command == Command::CLICK) {
+        put_u64(file, (uint16_t)entry.x, 2);
+        put_u64(file, (uint16_t)entry.y, 2);
+    } else if (entry.command == Command::HASH) {
+        put_u64(file, entry.hash, 8);
+    }
+    last_tick = entry.tick;
+}
+
+void replay::Recorder::close(void)
+{
+    if (file) fclose(file);
+    file = nullptr;
+}
+
+const char* replay::Player::load(const char* path)
+{
+    FILE* file = fopen(path, "rb");
+    if (!file) return "unable to open the input log";
+
+    char     header[sizeof(magic)];
+    uint64_t rate = 0, speed, accel;
+    bool     valid = fread(header, 1, sizeof(header), file) == sizeof(header)
+                     && memcmp(header, magic, sizeof(magic)) == 0
+                     && fgetc(file) == version && get_u64(file, &rate, 4)
+                     && get_u64(file, &speed, 4) && get_u64(file, &accel, 4)
+                     && rate > 0;
+    if (!valid) {
+        fclose(file);
+        return "not an input log (or an unsupported version)";
+    }
+
+    entries.clear();
+    next     = 0;
+    settings = { (uint32_t)rate, std::bit_cast<float>((uint32_t)speed),
+                 std::bit_cast<float>((uint32_t)accel) };
+
+    const char* error = nullptr;
+    uint64_t    tick = 0, delta;
+    while (!error && get_varint(file, &delta)) {
+        Entry entry;
+        int   command = fgetc(file);
+        if (command == EOF || command > (int)Command::HASH) {
+            error = "corrupt input log";
+            break;
+        }
+        tick          += delta;
+        entry.tick     = tick;
+        entry.command  = (Command)command;
+
+        uint64_t x, y;
+        if (entry.command == Command::CLICK) {
+            if (!get_u64(file, &x, 2) || !get_u64(file, &y, 2))
+                error = "corrupt input log";
+            entry.x = (int16_t)x;
+            entry.y = (int16_t)y;
+        } else if (entry.command == Command::HASH) {
+            if (!get_u64(file, &entry.hash, 8)) error = "corrupt input log";
+        }
+        entries.push_back(entry);
+    }
+    fclose(file);
+    return error;
+}
+
+/* Hand out the next entry if it's due at (or before) `tick'. Call this until
+ * it returns false before every simulation tick.
+ */
+bool replay::Player::next_due(uint64_t tick, Entry* entry)
+{
+    if (next >= entries.size() || entries[next].tick > tick) return false;
+    *entry = entries[next++];
+    return true;
+}
@@ -0,0 +1,79 @@
+#ifndef _REPLAY_H_
+#define _REPLAY_H_
+
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+/* Everything the player does is a `Command', stamped with the simulation tick
+ * (number of `Session::step()' calls so far) it was applied before. Since the
+ * simulation runs at a fixed tick rate, feeding the same commands at the same
+ * ticks reproduces a session exactly. To notice when it doesn't, the log also
+ * contains a hash of the game state every `hash_interval' ticks.
+ *
+ * The log is a small binary file: a header ("BRKL", version, `Settings'),
+ * then one entry per command (tick delta as a varint, command byte, payload
+ * for clicks and hashes). All numbers are little endian.
+ */
+namespace replay {
+    enum class Command : uint8_t {
+        LEFT_DOWN, LEFT_UP,   // arrow keys, pressed and released
+        RIGHT_DOWN, RIGHT_UP,
+        START,       // SPACE
+        PAUSE,       // P
+        KEY,         // any other key
+        CLICK,       // left mouse button at (x,y)
+        QUIT,        // Q or closing the window
+        HASH         // not a command, a checkpoint of the state hash
+    };
+
+    struct Entry {
+        uint64_t tick;
+        Command  command;
+        int16_t  x = 0, y = 0; // only for `CLICK'
+        uint64_t hash = 0;     // only for `HASH'
+    };
+
+    // what else, besides the commands, decides how a session goes
+    struct Settings {
+        uint32_t tick_rate;
+        float    paddle_speed, paddle_accel;
+    };
+
+    constexpr uint32_t hash_interval = 60;
+
+    uint64_t mix_hash(uint64_t, uint64_t);
+
+    class Recorder;
+    class Player;
+}
+
+class replay::Recorder {
+    FILE*    file = nullptr;
+    uint64_t last_tick = 0;
+public:
+    Recorder(void) = default;
+    Recorder(const Recorder&) = delete;
+    ~Recorder(void) { close(); }
+    Recorder& operator=(const Recorder&) = delete;
+
+    const char* open(const char*, const Settings&);
+    void        record(const Entry&);
+    void        close(void);
+    bool        is_open(void) const { return file != nullptr; }
+};
+
+// Reads a whole log and hands out its entries in order.
+class replay::Player {
+    std::vector<Entry> entries;
+    uint32_t           next = 0;
+    Settings           settings = {};
+public:
+    const char* load(const char*);
+    bool        next_due(uint64_t, Entry*);
+
+    bool            is_done(void) const      { return next >= entries.size(); }
+    const Settings& get_settings(void) const { return settings; }
+};
+
+#endif /* _REPLAY_H_ */
@@ -0,0 +1,273 @@
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "replay.hh"
+#include "scores.hh"
+
+static_assert(std::endian::native == std::endian::little,
+              "score files are mapped as they are, in little endian");
+static_assert(sizeof(scores::LogHeader) == 8 && sizeof(scores::Record) == 16
+              && sizeof(scores::IndexHeader) == 32 &&
+              sizeof(scores::Entry) == 16, "the layout on disk");
+
+static const char     log_magic[4]   = { 'B', 'R', 'K', 'S' };
+static const char     index_magic[4] = { 'B', 'R', 'K', 'T' };
+static const uint32_t version        = 1;
+static const uint64_t hash_seed      = 0xcbf29ce484222325ull;
+
+// the same FNV-1a as the replay state hash, cut to 32 bits
+static uint32_t record_checksum(int64_t time, uint32_t score)
+{
+    return replay::mix_hash(replay::mix_hash(hash_seed, time), score);
+}
+
+static uint32_t index_checksum(const scores::IndexHeader& header,
+                               const scores::Entry* entries)
+{
+    uint64_t hash = replay::mix_hash(hash_seed, header.covered);
+    hash = replay::mix_hash(hash, header.games);
+    hash = replay::mix_hash(hash, header.count);
+    for (uint32_t i = 0; i < header.count; i++)
+        hash = replay::mix_hash(hash, (uint64_t)entries[i].score << 32
+                                      ^ entries[i].time);
+    return hash;
+}
+
+/* Put `entry' into the list of the best games, at most `top_k' long. Higher
+ * scores come first, on a tie the older game stays ahead.
+ */
+static void insert(std::vector<scores::Entry>& top, const scores::Entry& entry)
+{
+    auto place = std::upper_bound(top.begin(), top.end(), entry,
+                                  [](const scores::Entry& a,
+                                     const scores::Entry& b) {
+        return a.score > b.score;
+    });
+    if ((uint32_t)(place - top.begin()) >= scores::top_k) return;
+    if (top.size() == scores::top_k) top.pop_back();
+    top.insert(place, entry);
+}
+
+// Replace the index at `path' as a whole, see `scores.hh'.
+static const char* write_index(const std::string& path,
+                               const std::vector<scores::Entry>& top,
+                               uint64_t games, uint64_t covered)
+{
+    scores::IndexHeader header = { {}, version, covered, games,
+                                   (uint32_t)top.size(), 0 };
+    memcpy(header.magic, index_magic, sizeof(index_magic));
+    header.checksum = index_checksum(header, top.data());
+
+    std::string temporary = path + ".tmp";
+    FILE* file = fopen(temporary.c_str(), "wb");
+    if (!file) return "unable to open the high score index for writing";
+    fwrite(&header, sizeof(header), 1, file);
+    fwrite(top.data(), sizeof(scores::Entry), top.size(), file);
+    bool failed = ferror(file) || fflush(file) != 0 ||
+                  fsync(fileno(file)) != 0;
+    if (fclose(file) != 0 || failed ||
+        rename(temporary.c_str(), path.c_str()) != 0)
+        return "unable to write the high score index";
+    return nullptr;
+}
+
+/* Open the log at `path' (it's created if it doesn't exist) and start
+ * flushing to it. On startup, only the index and the records appended after
+ * it was written are read.
+ */
+const char* scores::Store::open(const char* path)
+{
+    close();
+    log_path   = path;
+    index_path = log_path + ".idx";
+
+    int fd = ::open(path, O_RDWR | O_CREAT, 0644);
+    if (fd < 0) return "unable to open the high score log";
+
+    struct stat st;
+    LogHeader   header = { {}, version };
+    memcpy(header.magic, log_magic, sizeof(log_magic));
+    if (fstat(fd, &st) != 0) {
+        ::close(fd);
+        return "unable to open the high score log";
+    }
+    uint64_t size = st.st_size;
+    if (size == 0) {
+        if (write(fd, &header, sizeof(header)) != sizeof(header)) {
+            ::close(fd);
+            return "unable to write the high score log";
+        }
+        size = sizeof(header);
+    }
+
+    void* mapped = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+    if (mapped == MAP_FAILED) {
+        ::close(fd);
+        return "unable to map the high score log";
+    }
+    const uint8_t* data = (const uint8_t*)mapped;
+    if (size < sizeof(header) || memcmp(data, &header, sizeof(header)) != 0) {
+        munmap(mapped, size);
+        ::close(fd);
+        return "the high score log is not a score log";
+    }
+
+    top.clear();
+    games = 0;
+    bool     indexed = read_index(size);
+    uint64_t start   = indexed ? covered : sizeof(LogHeader);
+
+    // the records appended since the index was written (or all of them)
+    uint64_t end = start;
+    while (end + sizeof(Record) <= size) {
+        Record record;
+        memcpy(&record, data + end, sizeof(record));
+        if (record.checksum != record_checksum(record.time, record.score))
+            break; // torn by a crash, it and everything after it is lost
+        insert(top, { record.time, record.score, 0 });
+        games++;
+        end += sizeof(Record);
+    }
+    munmap(mapped, size);
+
+    if (end < size && ftruncate(fd, end) != 0)
+        std::cerr << "unable to cut off the torn end of the high scores\n";
+    ::close(fd);
+
+    if (!indexed || end != start) {
+        if (const char* error = write_index(index_path, top, games, end))
+            std::cerr << error << '\n'; // it's rebuilt next time
+    }
+
+    log = fopen(path, "ab");
+    if (!log) return "unable to open the high score log";
+    // so `submit()' (called mid-frame) doesn't allocate, see `alloc.hh'
+    top.reserve(top_k + 1);
+    submitted.reserve(64);
+    batch.reserve(64);
+    flushed_top   = top;
+    flushed_games = games;
+    covered       = end;
+    stopping      = false;
+    flusher       = std::thread(&Store::run, this);
+    return nullptr;
+}
+
+/* Map the index and take the best games from it, if it's intact and matches
+ * a log of `log_size' bytes. Sets `covered'.
+ */
+bool scores::Store::read_index(uint64_t log_size)
+{
+    int fd = ::open(index_path.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(IndexHeader)) {
+        ::close(fd);
+        return false;
+    }
+    void* mapped = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd); // the mapping keeps the file open
+    if (mapped == MAP_FAILED) return false;
+
+    const IndexHeader* header  = (const IndexHeader*)mapped;
+    const Entry*       entries = (const Entry*)(header + 1);
+    const uint64_t     records = header->covered - sizeof(LogHeader);
+    bool valid = memcmp(header->magic, index_magic, sizeof(index_magic)) == 0
+                 && header->version == version && header->count <= top_k &&
+                 (size_t)st.st_size == sizeof(IndexHeader)
+                                       + header->count * sizeof(Entry) &&
+                 header->covered >= sizeof(LogHeader) &&
+                 header->covered <= log_size &&
+                 records % sizeof(Record) == 0 &&
+                 header->games == records / sizeof(Record) &&
+                 header->checksum == index_checksum(*header, entries);
+    if (valid) {
+        top.assign(entries, entries + header->count);
+        games   = header->games;
+        covered = header->covered;
+    }
+    munmap(mapped, st.st_size);
+    return valid;
+}
+
+// Write out whatever was submitted, then stop flushing.
+void scores::Store::close(void)
+{
+    if (flusher.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wake.notify_one();
+        flusher.join();
+    }
+    if (log) fclose(log);
+    log = nullptr;
+}
+
+/* Record a game. The list of the best games changes right away, the disk is
+ * left to the flusher.
+ */
+void scores::Store::submit(uint32_t score, int64_t time)
+{
+    if (!log) return;
+    insert(top, { time, score, 0 });
+    games++;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        submitted.push_back({ time, score, 0 });
+    }
+    wake.notify_one();
+}
+
+// The place (from 1) a game with `score' would get, `top_k + 1' if none.
+uint32_t scores::Store::rank(uint32_t score) const
+{
+    auto place = std::upper_bound(top.begin(), top.end(), score,
+                                  [](uint32_t s, const Entry& e) {
+        return s > e.score;
+    });
+    return std::min<uint32_t>(place - top.begin(), top_k) + 1;
+}
+
+/* The flusher: take all submitted games at once, append them to the log and
+ * make sure they're on disk, then write the index to match.
+ */
+void scores::Store::run(void)
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    bool broken = false; // a write failed, the next open checks the log
+    while (true) {
+        wake.wait(lock, [&](void) { return stopping || !submitted.empty(); });
+        if (submitted.empty()) break; // stopping, and nothing left
+        batch.swap(submitted);
+        lock.unlock();
+
+        for (const Entry& entry: batch) {
+            Record record = { entry.time, entry.score,
+                              record_checksum(entry.time, entry.score) };
+            fwrite(&record, sizeof(record), 1, log);
+        }
+        if (ferror(log) || fflush(log) != 0 || fsync(fileno(log)) != 0) {
+            if (!broken) std::cerr << "unable to write the high score log\n";
+            broken = true; // the index stays as it is from now on
+            clearerr(log);
+        } else if (!broken) {
+            for (const Entry& entry: batch) insert(flushed_top, entry);
+            flushed_games += batch.size();
+            covered       += batch.size() * sizeof(Record);
+            if (const char* error = write_index(index_path, flushed_top,
+                                                flushed_games, covered))
+                std::cerr << error << '\n';
+        }
+        batch.clear();
+        lock.lock();
+    }
+}
@@ -0,0 +1,100 @@
+#ifndef _SCORES_H_
+#define _SCORES_H_
+
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/* High scores are kept in two files next to each other:
+ *     log      "BRKS", version, then one record per game ever played (time,
+ *              score, checksum); it's only ever appended to
+ *     index    "BRKT", version, how much of the log it covers, number of
+ *              games, checksum, then the best `top_k' games, best first
+ * A record only counts with a matching checksum, so one that was torn by a
+ * crash is noticed (and cut off) when the log is opened again.
+ * The index (`<log>.idx') is a cache: it's mapped on startup, so only the
+ * records appended since it was written are read from the log, never the
+ * whole history. If it's missing or broken, the log is read once and the
+ * index written anew. It's always replaced as a whole (written to a
+ * temporary file that's renamed), so it's either old or new, never torn.
+ * All numbers are little endian, the structs are the exact layout on disk.
+ */
+namespace scores {
+    struct LogHeader {
+        char     magic[4];
+        uint32_t version;
+    };
+
+    struct Record {
+        int64_t  time;     // seconds since the epoch
+        uint32_t score;
+        uint32_t checksum; // of `time' and `score'
+    };
+
+    struct IndexHeader {
+        char     magic[4];
+        uint32_t version;
+        uint64_t covered;  // bytes of the log included below
+        uint64_t games;    // records in those bytes
+        uint32_t count;    // entries that follow, at most `top_k'
+        uint32_t checksum; // of all of the above and the entries
+    };
+
+    struct Entry {
+        int64_t  time;
+        uint32_t score;
+        uint32_t reserved;
+    };
+
+    constexpr uint32_t top_k = 100;
+
+    class Store;
+}
+
+/* The high scores of all games played. Queries are answered from memory,
+ * `submit()' only queues the score: a background thread appends it to the
+ * log and rewrites the index, so a frame never waits for the disk.
+ * Everything but the flushing happens on the thread that owns the store.
+ */
+class scores::Store {
+    std::string        log_path, index_path;
+    std::vector<Entry> top;       // best first, see `insert()'
+    uint64_t           games = 0; // ever played, including `top'
+
+    // shared with the flusher, under `mutex'
+    std::mutex              mutex;
+    std::condition_variable wake;
+    std::vector<Entry>      submitted; // not written yet
+    bool                    stopping = false;
+
+    // the flusher's own, it's the only one writing the files
+    std::thread        flusher;
+    FILE*              log = nullptr;
+    std::vector<Entry> batch;
+    std::vector<Entry> flushed_top;
+    uint64_t           flushed_games = 0;
+    uint64_t           covered = 0;
+
+    bool read_index(uint64_t);
+    void run(void);
+public:
+    Store(void) = default;
+    Store(const Store&) = delete;
+    ~Store(void) { close(); }
+    Store& operator=(const Store&) = delete;
+
+    const char* open(const char*);
+    void        close(void);
+    void        submit(uint32_t, int64_t);
+    uint32_t    rank(uint32_t) const;
+
+    bool                      is_open(void) const { return log != nullptr; }
+    const std::vector<Entry>& get_top(void) const { return top; }
+    uint64_t                  get_games(void) const { return games; }
+};
+
+#endif /* _SCORES_H_ */
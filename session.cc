@@ -0,0 +1,335 @@
+#include <bit>
+
+#include "session.hh"
+
+/* A session of the default level in a `width' x `height' window, or of the
+ * level in `map' (scrolled through in a window `height' pixels high).
+ */
+Session::Session(int32_t width, int32_t height, uint32_t tick_rate,
+                 InputQueue& commands, const level::Map* map)
+    : sim(map ? Simulation(*map, height, tick_rate)
+              : Simulation(width, height, tick_rate)),
+      tick_rate(tick_rate),
+      blocks(copy_blocks()),
+      band(sim.get_band()), commands(commands), snapshots(first_snapshot())
+{
+    backlog.reserve(1024); // as many as `notices' holds, see `publish()'
+}
+
+// NOTE: Called before `snapshots' is constructed, `sim' and `blocks' are ready.
+Snapshot Session::first_snapshot(void)
+{
+    std::vector<Ball> balls;
+    copy_balls(balls);
+    return { 0, SDL_GetPerformanceCounter(), state, sim.get_player(),
+             std::move(balls), 0, blocks, generation, band, false };
+}
+
+/* A copy of the simulation's blocks to publish. It goes into a store no
+ * snapshot refers to anymore, which kept its memory, so that streaming doesn't
+ * allocate once there are enough stores (at most one per snapshot, plus the
+ * current one). Only this thread hands out references to the stores, so one
+ * that is only in `stores' stays that way.
+ */
+std::shared_ptr<const BlockStore> Session::copy_blocks(void)
+{
+    std::shared_ptr<BlockStore> store;
+    for (const std::shared_ptr<BlockStore>& s: stores)
+        if (s.use_count() == 1) {
+            // see the main thread's last reads before it let go of `s'
+            std::atomic_thread_fence(std::memory_order_acquire);
+            store = s;
+            break;
+        }
+    if (!store) store = stores.emplace_back(std::make_shared<BlockStore>());
+    *store = sim.get_blocks();
+    return store;
+}
+
+// The balls in play, the lead first. `balls' keeps its memory.
+void Session::copy_balls(std::vector<Ball>& balls) const
+{
+    const BallPool& pool = sim.get_balls();
+    balls.clear();
+    balls.push_back(sim.get_ball());
+    for (uint32_t i = 0; i < pool.size(); i++)
+        if (pool.is_alive(i) && &pool[i] != &sim.get_ball())
+            balls.push_back(pool[i]);
+}
+
+void Session::set_paddle_motion(float speed, float accel)
+{
+    sim.set_paddle_motion(speed, accel);
+}
+
+// Stress mode: `n' more balls, see `Simulation::spawn_balls()'.
+void Session::spawn_balls(uint32_t n)
+{
+    sim.spawn_balls(n);
+}
+
+// Write every command (and the state hash) to a log at `path'.
+const char* Session::record(const char* path, const replay::Settings& settings)
+{
+    return recorder.open(path, settings);
+}
+
+// Take the commands from `log' instead of the `InputQueue'.
+void Session::set_replay(replay::Player&& log)
+{
+    replay    = std::move(log);
+    replaying = true;
+}
+
+void Session::start(void)
+{
+    stopping.store(false, std::memory_order_release);
+    thread = std::thread(&Session::run, this);
+}
+
+void Session::stop(void)
+{
+    stopping.store(true, std::memory_order_release);
+    commands.wake();
+    if (thread.joinable()) thread.join();
+}
+
+/* Play the whole replay as fast as possible on the calling thread. Nothing
+ * is published, so there's nobody to take the notices either.
+ */
+void Session::run_replay(void)
+{
+    while (feed()) {
+        step();
+        backlog.clear();
+    }
+}
+
+// Close the log, with the final state (so even short sessions are checked).
+void Session::finish(void)
+{
+    if (!recorder.is_open()) return;
+    recorder.record({ tick, replay::Command::HASH, 0, 0, state_hash });
+    recorder.record({ tick, replay::Command::QUIT });
+    recorder.close();
+}
+
+/* Ticks are simulated in batches: whenever the time slices of one or more
+ * ticks are over, they're simulated right away and the result is published.
+ * If the session can't keep up, at most `max_steps' ticks are simulated in a
+ * batch and the rest of the backlog is dropped (the game slows down instead
+ * of spiralling to death).
+ * While nothing moves (menus, pause, end screens) there are no ticks, the
+ * thread sleeps until a command arrives and applies it right away. A replay
+ * keeps ticking, its log expects the ticks to go on.
+ */
+void Session::run(void)
+{
+    const double   freq      = SDL_GetPerformanceFrequency();
+    const double   tick_time = 1.0 / tick_rate;
+    const uint64_t origin    = SDL_GetPerformanceCounter();
+    const uint32_t origin_ms = SDL_GetTicks(); // the clock of event timestamps
+    double         next      = 0.0; // when the next tick starts (since origin)
+
+    auto now = [&](void) {
+        return (SDL_GetPerformanceCounter() - origin) / freq;
+    };
+
+    while (!quit && !stopping.load(std::memory_order_acquire)) {
+        if (!replaying && !is_animated()) {
+            commands.wait(stopping);
+            take_commands(SDL_GetTicks() + 1);
+            next = now(); // don't catch up on the time spent waiting
+            publish(SDL_GetPerformanceCounter());
+            continue;
+        }
+
+        double   current = now();
+        uint32_t steps   = 0;
+        while (current >= next + tick_time && steps < max_steps) {
+            if (replaying) {
+                commands.clear(); // live input doesn't count
+                if (!feed()) {
+                    quit = true;
+                    break;
+                }
+            } else {
+                // commands from within the tick's time slice
+                take_commands(origin_ms + (uint32_t)((next + tick_time)
+                                                     * 1000.0));
+            }
+            step();
+            next += tick_time;
+            steps++;
+        }
+        if (current >= next + tick_time) next = current;
+        if (steps > 0 || quit) publish(origin + (uint64_t)(next * freq));
+
+        double wait = next + tick_time - now();
+        if (wait > 0.001) SDL_Delay((uint32_t)(wait * 1000.0));
+        else              std::this_thread::yield();
+    }
+    publish(SDL_GetPerformanceCounter());
+}
+
+// Apply every queued command that happened before `time' (milliseconds).
+void Session::take_commands(uint32_t time)
+{
+    replay::Entry entry;
+    while (commands.next_due(time, &entry)) {
+        entry.tick = tick;
+        recorder.record(entry);
+        apply(entry);
+    }
+}
+
+// Apply what the replay has for this tick, false once it's over.
+bool Session::feed(void)
+{
+    replay::Entry entry;
+    while (replay.next_due(tick, &entry)) {
+        if (entry.command == replay::Command::QUIT) return false;
+        if (entry.command != replay::Command::HASH) {
+            apply(entry);
+        } else if (entry.hash == state_hash) {
+            checked++;
+        } else {
+            diverged = true;
+            return false;
+        }
+    }
+    return !replay.is_done();
+}
+
+void Session::apply(const replay::Entry& entry)
+{
+    using replay::Command;
+
+    switch (entry.command) {
+    case Command::LEFT_DOWN:  input.left  = true;  break;
+    case Command::LEFT_UP:    input.left  = false; break;
+    case Command::RIGHT_DOWN: input.right = true;  break;
+    case Command::RIGHT_UP:   input.right = false; break;
+    case Command::PAUSE:
+        // pausing doesn't do much for most game states
+        if (state == GameState::PLAYING)     state = GameState::PAUSED;
+        else if (state == GameState::PAUSED) state = GameState::PLAYING;
+        break;
+    case Command::START:
+        if (state == GameState::START) state = GameState::PLAYING;
+        break;
+    case Command::CLICK:
+        {
+            SDL_Point point = { entry.x, entry.y };
+            if (state == GameState::START &&
+                SDL_PointInRect(&point, &highscore_button))
+                state = GameState::HIGHSCORE;
+        }
+        break;
+    case Command::KEY:
+        if (state == GameState::START)     state = GameState::PLAYING;
+        else if (state == GameState::LOST) quit = true;
+        input.launch = true;
+        break;
+    case Command::QUIT:
+    case Command::HASH:
+        break;
+    }
+}
+
+/* One tick: step the simulation (only while playing) and fold the state into
+ * the hash. What happened is kept for the next snapshot.
+ */
+void Session::step(void)
+{
+    if (state == GameState::PLAYING) {
+        for (const Simulation::Event& event: sim.step(input)) {
+            const SDL_Rect& r = event.rect;
+            event_hash = replay::mix_hash(event_hash, (uint64_t)event.type);
+            event_hash = replay::mix_hash(event_hash, (uint64_t)(uint32_t)r.x
+                                                      << 32 | (uint32_t)r.y);
+            if (event.type == Simulation::EventType::LOST)
+                state = GameState::LOST;
+            else if (event.type == Simulation::EventType::WON)
+                state = GameState::WON;
+            backlog.push_back({ tick + 1, generation, event });
+        }
+        input.launch = false;
+
+        // streaming replaced the blocks, after this tick's events
+        const SDL_Rect& current = sim.get_band();
+        if (current.y != band.y || current.h != band.h) {
+            band = current;
+            generation++;
+        }
+    }
+
+    tick++;
+    state_hash = replay::mix_hash(state_hash, get_state_hash());
+    if (tick % replay::hash_interval == 0)
+        recorder.record({ tick, replay::Command::HASH, 0, 0, state_hash });
+}
+
+/* A hash of everything that decides how the game goes on, used to check that
+ * a replay still follows the recorded session. Floats are hashed bit by bit,
+ * so even the smallest difference shows up.
+ */
+uint64_t Session::get_state_hash(void) const
+{
+    const BallPool& balls   = sim.get_balls();
+    SDL_Rect        p       = sim.get_player().get_rect();
+    uint32_t        started = 0;
+
+    uint64_t hash = replay::mix_hash(event_hash, (uint64_t)state);
+    for (uint32_t i = 0; i < balls.size(); i++) {
+        if (!balls.is_alive(i)) continue;
+        const Ball& ball = balls[i];
+        float floats[] = { ball.get_x(), ball.get_y(), ball.get_xvel(),
+                           ball.get_yvel() };
+        for (float f: floats)
+            hash = replay::mix_hash(hash, std::bit_cast<uint32_t>(f));
+        started += ball.is_started();
+    }
+    hash = replay::mix_hash(hash, (uint64_t)(uint32_t)p.x << 32 | started);
+    hash = replay::mix_hash(hash, (uint64_t)sim.get_score() << 32
+                                  | sim.get_blocks().count());
+    return hash;
+}
+
+/* Hand the current state to the main thread. The blocks are only copied once
+ * others were streamed in, hits go through the notices (see `Snapshot').
+ * When nothing is animated, the main thread is blocked waiting for events, so
+ * it gets one to wake up.
+ */
+void Session::publish(uint64_t time)
+{
+    if (published != generation) {
+        blocks    = copy_blocks();
+        published = generation;
+    }
+
+    uint32_t sent = 0;
+    while (sent < backlog.size() && notices.push(backlog[sent])) sent++;
+    backlog.erase(backlog.begin(), backlog.begin() + sent);
+
+    // field by field, so the ball list can reuse its memory
+    Snapshot& s = snapshots.get_back();
+    s.tick       = tick;
+    s.time       = time;
+    s.state      = state;
+    s.player     = sim.get_player();
+    copy_balls(s.balls);
+    s.score      = sim.get_score();
+    s.blocks     = blocks;
+    s.generation = published;
+    s.band       = band;
+    s.quit       = quit;
+    snapshots.publish();
+
+    if (!replaying && (!is_animated() || quit)) {
+        SDL_Event event;
+        SDL_zero(event);
+        event.type = SDL_USEREVENT;
+        SDL_PushEvent(&event);
+    }
+}
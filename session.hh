@@ -0,0 +1,140 @@
+#ifndef _SESSION_H_
+#define _SESSION_H_
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <SDL2/SDL.h>
+#include <thread>
+#include <vector>
+
+#include "input.hh"
+#include "level.hh"
+#include "replay.hh"
+#include "sim.hh"
+#include "spsc.hh"
+#include "triple.hh"
+
+enum class GameState { START, HIGHSCORE, PLAYING, PAUSED, WON, LOST };
+
+/* What the renderer gets to see of a `Session' after a batch of ticks. It's
+ * a copy, so the main thread can keep drawing it while the session moves on.
+ * The blocks are only copied when other ones were streamed in, which starts
+ * a new `generation' (a published `BlockStore' is shared, it never changes).
+ * Bricks that are destroyed afterwards only come as notices, the main thread
+ * keeps its own copy of the blocks up to date with those.
+ */
+struct Snapshot {
+    uint64_t  tick;  // ticks simulated so far
+    uint64_t  time;  // performance counter at the end of the last tick
+    GameState state;
+    Player    player;
+    std::vector<Ball> balls; // in play, the lead ball (see `Simulation') first
+    uint32_t  score;
+    std::shared_ptr<const BlockStore> blocks; // as the generation started
+    uint32_t  generation;
+    SDL_Rect  band;  // the part of the level `blocks' covers
+    bool      quit;  // the session is over
+};
+
+/* A simulation event, to be handled once a snapshot of `tick' is shown. The
+ * brick index in `event' refers to the blocks of `generation'.
+ */
+struct Notice {
+    uint64_t          tick;
+    uint32_t          generation;
+    Simulation::Event event;
+};
+
+/* A `Session' is the game without anything to see or hear: the states (menu,
+ * playing, paused, ...) and the simulation, driven by commands from an
+ * `InputQueue' or a replay log. It runs on its own thread at the fixed tick
+ * rate (see `start()'), so a frame that takes long to render or present
+ * doesn't hold up the simulation. All the main thread gets to see is what
+ * the session publishes: a `Snapshot' after every batch of ticks (through a
+ * triple buffer, the latest one wins) and a `Notice' for every simulation
+ * event (through a queue, none get lost).
+ */
+class Session {
+public:
+    static constexpr SDL_Rect highscore_button = { 10, 10, 250, 80 };
+    static constexpr uint32_t max_steps        = 8; // ticks per batch
+private:
+    Simulation        sim;
+    Simulation::Input input;
+    GameState         state = GameState::START;
+    bool              quit  = false;
+    const uint32_t    tick_rate;
+
+    // see `replay.hh'
+    uint64_t          tick       = 0;
+    uint64_t          event_hash = 0; // all simulation events so far
+    uint64_t          state_hash = 0xcbf29ce484222325ull; // all ticks so far
+    uint64_t          checked    = 0; // checkpoints that matched the replay
+    bool              diverged   = false;
+    bool              replaying  = false;
+    replay::Recorder  recorder;
+    replay::Player    replay;
+
+    // before `snapshots', the first one is made of them
+    std::vector<std::shared_ptr<BlockStore>> stores; // see `copy_blocks()'
+    std::shared_ptr<const BlockStore> blocks;  // see `Snapshot'
+    SDL_Rect                          band;    // covered by the simulation
+    uint32_t                          generation = 0; // of the blocks
+    uint32_t                          published  = 0; // copied to `blocks'
+
+    InputQueue&                       commands;
+    TripleBuffer<Snapshot>            snapshots;
+    SpscQueue<Notice, 1024>           notices;
+    std::vector<Notice>               backlog; // not in `notices' yet
+
+    std::thread       thread;
+    std::atomic<bool> stopping = false;
+
+    void     apply(const replay::Entry&);
+    void     step(void);
+    bool     feed(void);
+    void     take_commands(uint32_t);
+    void     publish(uint64_t);
+    void     run(void);
+    Snapshot first_snapshot(void);
+    std::shared_ptr<const BlockStore> copy_blocks(void);
+    void     copy_balls(std::vector<Ball>&) const;
+    uint64_t get_state_hash(void) const;
+    bool     is_animated(void) const { return state == GameState::PLAYING; }
+public:
+    Session(int32_t, int32_t, uint32_t, InputQueue&,
+            const level::Map* = nullptr);
+    Session(const Session&) = delete;
+    ~Session(void) { stop(); }
+    Session& operator=(const Session&) = delete;
+
+    // before `start()'
+    void        set_paddle_motion(float, float);
+    void        spawn_balls(uint32_t);
+    const char* record(const char*, const replay::Settings&);
+    void        set_replay(replay::Player&&);
+
+    void start(void);
+    void stop(void);
+    void run_replay(void);
+    void finish(void);
+
+    // main thread, while running
+    bool update(void) { return snapshots.update(); }
+    bool next_notice(Notice* notice) { return notices.pop(notice); }
+    const Snapshot& get_snapshot(void) const { return snapshots.get_front(); }
+
+    // the level, these never change
+    int32_t get_width(void) const       { return sim.get_width(); }
+    int32_t get_height(void) const      { return sim.get_height(); }
+    int32_t get_band_height(void) const { return sim.get_band_height(); }
+
+    // once stopped
+    uint64_t get_tick(void) const      { return tick; }
+    uint64_t get_checked(void) const   { return checked; }
+    bool     is_diverged(void) const   { return diverged; }
+    bool     is_replay_done(void) const { return replay.is_done(); }
+};
+
+#endif /* _SESSION_H_ */
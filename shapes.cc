@@ -1,6 +1,7 @@
 #include <algorithm>
 #include <cmath>
 #include <cstdio>
+#include <iostream>
 #include <SDL2/SDL.h>
 
 #include "shapes.hh"
@@ -40,3 +41,154 @@ void shapes::Circle::render(SDL_Renderer* renderer) const
             if ((px*px) + (py*py) <= rsquared)
                 SDL_RenderDrawPoint(renderer, px+x, py+y);
 }
+
+/* Same scanline idea as `render1()', but along the y axis and without issuing
+ * one renderer call per line: every row of the circle becomes a quad (two
+ * triangles) and all of them are submitted with a single `SDL_RenderGeometry()'.
+ * The caller owns the buffers, they're reused so that this doesn't allocate
+ * once they're large enough.
+ */
+void shapes::Circle::render_spans(SDL_Renderer* renderer,
+                                  const SDL_Color& color,
+                                  std::vector<SDL_Vertex>& vertices,
+                                  std::vector<int>& indices) const
+{
+    vertices.clear();
+    indices.clear();
+    int32_t radius = w / 2;
+    for (int32_t py = -radius; py <= radius; py++) {
+        SDL_Rect span = get_span(py);
+        float    x0 = span.x, x1 = span.x + span.w;
+        float    y0 = span.y, y1 = span.y + span.h;
+
+        int base = vertices.size();
+        vertices.push_back({ { x0, y0 }, color, { 0, 0 } });
+        vertices.push_back({ { x1, y0 }, color, { 0, 0 } });
+        vertices.push_back({ { x1, y1 }, color, { 0, 0 } });
+        vertices.push_back({ { x0, y1 }, color, { 0, 0 } });
+        for (int i: { 0, 1, 2, 0, 2, 3 }) indices.push_back(base + i);
+    }
+    SDL_RenderGeometry(renderer, NULL, vertices.data(), vertices.size(),
+                       indices.data(), indices.size());
+}
+
+// The row `py' (in [-radius, radius], relative to the midpoint) of the circle.
+SDL_Rect shapes::Circle::get_span(int32_t py) const
+{
+    int32_t radius = w / 2;
+    int32_t half   = (int32_t)sqrt((double)(radius*radius - py*py));
+    return { x - half, y + py, 2*half + 1, 1 };
+}
+
+// The square that `rasterize()' fills.
+SDL_Rect shapes::Circle::get_bounds(void) const
+{
+    int32_t radius = w / 2;
+    return { x - radius, y - radius, 2*radius + 1, 2*radius + 1 };
+}
+
+/* Draw the circle into a new RGBA surface of size (2*radius+1)^2, with the
+ * midpoint in its center. Without anti-aliasing, the coverage test is the same
+ * as in `render()'. With anti-aliasing, every pixel is sampled on a 4x4 grid
+ * and the fraction of samples inside the circle becomes its alpha value. The
+ * caller owns the returned surface, `nullptr' is returned on errors.
+ */
+SDL_Surface* shapes::Circle::rasterize(const SDL_Color& color,
+                                       bool antialias) const
+{
+    const int32_t radius = w / 2;
+    const int32_t size   = 2*radius + 1;
+    SDL_Surface* surface = SDL_CreateRGBSurfaceWithFormat(0, size, size, 32,
+                                                          SDL_PIXELFORMAT_RGBA32);
+    if (!surface) return nullptr;
+
+    const int32_t samples = 4;
+    const float   edge    = (radius + 0.5f) * (radius + 0.5f);
+    uint8_t* pixels = static_cast<uint8_t*>(surface->pixels);
+    for (int32_t py = -radius; py <= radius; py++) {
+        uint8_t* row = pixels + (py + radius) * surface->pitch;
+        for (int32_t px = -radius; px <= radius; px++) {
+            uint32_t coverage = 0; // in [0, 255]
+            if (!antialias) {
+                coverage = (px*px + py*py <= radius*radius) ? 255 : 0;
+            } else {
+                uint32_t inside = 0;
+                for (int32_t sy = 0; sy < samples; sy++)
+                    for (int32_t sx = 0; sx < samples; sx++) {
+                        float fx = px - 0.5f + (sx + 0.5f) / samples;
+                        float fy = py - 0.5f + (sy + 0.5f) / samples;
+                        if (fx*fx + fy*fy <= edge) inside++;
+                    }
+                coverage = inside * 255 / (samples * samples);
+            }
+
+            uint8_t* pixel = row + (px + radius) * 4; // RGBA32 is r,g,b,a
+            pixel[0] = color.r;
+            pixel[1] = color.g;
+            pixel[2] = color.b;
+            pixel[3] = color.a * coverage / 255;
+        }
+    }
+    return surface;
+}
+
+SDL_Texture* shapes::CircleSprites::get(SDL_Renderer* renderer,
+                                        const Circle& circle,
+                                        const SDL_Color& color, bool antialias)
+{
+    uint64_t key = (uint64_t)circle.get_width() << 33 |
+                   (uint64_t)antialias << 32 |
+                   (uint64_t)color.r << 24 | (uint64_t)color.g << 16 |
+                   (uint64_t)color.b << 8  | (uint64_t)color.a;
+
+    auto it = sprites.find(key);
+    if (it != sprites.end()) return it->second;
+
+    SDL_Texture* texture = nullptr;
+    if (SDL_Surface* surface = circle.rasterize(color, antialias)) {
+        texture = SDL_CreateTextureFromSurface(renderer, surface);
+        SDL_FreeSurface(surface);
+    }
+    if (!texture) {
+        std::cerr << "error: unable to create circle sprite: "
+                  << SDL_GetError() << '\n';
+        return nullptr;
+    }
+    SDL_SetTextureBlendMode(texture, SDL_BLENDMODE_BLEND);
+    sprites[key] = texture;
+    return texture;
+}
+
+void shapes::CircleSprites::render(SDL_Renderer* renderer,
+                                   const Circle& circle, const SDL_Color& color,
+                                   bool antialias)
+{
+    if (circle.get_width() > max_diameter) {
+        circle.render_spans(renderer, color, vertices, indices);
+        return;
+    }
+
+    SDL_Texture* texture = get(renderer, circle, color, antialias);
+    if (!texture) {
+        circle.render_spans(renderer, color, vertices, indices);
+        return;
+    }
+
+    SDL_Rect dest = circle.get_bounds();
+    SDL_RenderCopy(renderer, texture, NULL, &dest);
+}
+
+shapes::CircleSprites::CircleSprites(void) = default;
+
+shapes::CircleSprites::~CircleSprites(void)
+{
+    clear();
+}
+
+// NOTE: Must be called before the renderer that created the sprites is gone.
+void shapes::CircleSprites::clear(void)
+{
+    for (std::pair<const uint64_t, SDL_Texture*>& pair: sprites)
+        SDL_DestroyTexture(pair.second);
+    sprites.clear();
+}
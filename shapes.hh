@@ -2,9 +2,20 @@
 #define _SHAPES_H_
 
 #include <cstdint>
-#include <SDL2/SDL.h>
+#include <SDL2/SDL_rect.h>
+#include <unordered_map>
+#include <vector>
+
+// only needed for rendering, see `shapes.cc'
+struct SDL_Renderer;
+struct SDL_Surface;
+struct SDL_Texture;
+struct SDL_Color;
+struct SDL_Vertex;
 
 namespace shapes {
+    class CircleSprites;
+
     // `Circle' is fairly similar to `SDL_Rect', see `render()' for the actual
     // pixel-by-pixel rendering algorithm.
     struct Circle {
@@ -16,13 +27,43 @@ namespace shapes {
 
         void render(SDL_Renderer*) const;
         void render1(SDL_Renderer*) const;
+        void render_spans(SDL_Renderer*, const SDL_Color&,
+                          std::vector<SDL_Vertex>&, std::vector<int>&) const;
+        SDL_Surface* rasterize(const SDL_Color&, bool) const;
+        SDL_Rect get_span(int32_t) const;
+        SDL_Rect get_bounds(void) const;
 
         void update_x(int32_t x) { this->x += x; };
         void update_y(int32_t y) { this->y += y; };
-        int32_t get_x(void)      { return this->x; }
-        int32_t get_y(void)      { return this->y; }
-        int32_t get_width(void)  { return this->w; }
+        int32_t get_x(void) const     { return this->x; }
+        int32_t get_y(void) const     { return this->y; }
+        int32_t get_width(void) const { return this->w; }
     };
 }
 
+/* Pre-rasterized circles, one texture per diameter, color and edge mode. The
+ * ball looks the same every frame, so drawing it becomes a single copy instead
+ * of one renderer call per pixel (`render()') or column (`render1()'). Circles
+ * that are larger than `max_diameter' aren't cached and are drawn as a batch of
+ * spans instead.
+ */
+class shapes::CircleSprites {
+    std::unordered_map<uint64_t, SDL_Texture*> sprites;
+    std::vector<SDL_Vertex> vertices; // for `Circle::render_spans()'
+    std::vector<int>        indices;
+
+public:
+    static constexpr int32_t max_diameter = 128;
+
+    // NOTE: Out of line, `SDL_Vertex' is only complete in `shapes.cc'.
+    CircleSprites(void);
+    CircleSprites(const CircleSprites&) = delete;
+    ~CircleSprites(void);
+    CircleSprites& operator=(const CircleSprites&) = delete;
+
+    SDL_Texture* get(SDL_Renderer*, const Circle&, const SDL_Color&, bool);
+    void render(SDL_Renderer*, const Circle&, const SDL_Color&, bool = true);
+    void clear(void);
+};
+
 #endif /* _SHAPES_H_ */
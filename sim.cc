@@ -0,0 +1,516 @@
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <numbers>
+
+#include "shapes.hh"
+#include "sim.hh"
+
+// the player sits `ypadding' pixels above the bottom of the level
+static const int32_t xplayer  = 40;
+static const int32_t ypadding = 70;
+static const int32_t wplayer  = 150;
+static const int32_t hplayer  = 20;
+static const int32_t wball    = 35;
+
+const Simulation::Reflections Simulation::default_reflections = { {
+    { -9, -4 }, { -7, -5 }, { -7, -4 }, { -6, -5 }, { -4, -7 },
+    {  4, -7 }, {  6, -5 }, {  7, -4 }, {  7, -5 }, {  9, -4 },
+} };
+
+static Player default_player(int32_t height)
+{
+    return Player(xplayer, height - ypadding, wplayer, hplayer);
+}
+
+static Ball default_ball(int32_t height)
+{
+    int32_t xball = xplayer + wplayer/2;
+    int32_t yball = height - ypadding - wball/2 - 5;
+    return Ball(xball, yball, wball);
+}
+
+Simulation::Simulation(int32_t width, int32_t height, uint32_t tick_rate)
+    : width(width), height(height), dt(1.0f / tick_rate),
+      player(default_player(height)), band({ 0, 0, width, height }),
+      band_height(height), paddle_speed(default_paddle_speed),
+      paddle_accel(default_paddle_accel)
+{
+    add_ball(default_ball(height));
+
+    const uint32_t block_width  = 80;
+    const uint32_t block_height = 40;
+    const uint32_t xmargin      = 10;
+    const uint32_t ymargin      = 5;
+    const uint32_t num_blocks_x = (width-xmargin) / block_width;
+    const uint32_t num_blocks_y = 4;
+
+    for (uint32_t x = 0; x < num_blocks_x; x++)
+        for (uint32_t y = 0; y < num_blocks_y; y++) {
+            int32_t bx = x*block_width + (x+1)*xmargin;
+            int32_t by = y*block_height + (y+1)*ymargin;
+            blocks.add({ bx, by, block_width, block_height },
+                       num_blocks_y - y);
+        }
+    build_grid();
+}
+
+/* Start with the given blocks instead of the default level. The game is won
+ * once all of them are destroyed.
+ */
+Simulation::Simulation(int32_t width, int32_t height,
+                       const std::vector<Block>& level, uint32_t tick_rate)
+    : width(width), height(height), dt(1.0f / tick_rate),
+      player(default_player(height)), band({ 0, 0, width, height }),
+      band_height(height), winning_score(level.size()),
+      paddle_speed(default_paddle_speed), paddle_accel(default_paddle_accel)
+{
+    add_ball(default_ball(height));
+    for (const Block& block: level)
+        blocks.add(block.get_rect(), block.get_strength());
+    build_grid();
+}
+
+/* Play a level file, which can be much higher than the screen. Its bricks are
+ * streamed: only the chunks within `view_height' above and below the ball are
+ * in `blocks', see `stream()'. The map must outlive the simulation.
+ */
+Simulation::Simulation(const level::Map& map, int32_t view_height,
+                       uint32_t tick_rate)
+    : width(map.get_width()), height(map.get_height()),
+      dt(1.0f / tick_rate), player(default_player(height)),
+      band({ 0, 0, 0, 0 }), winning_score(map.get_num_bricks()),
+      paddle_speed(default_paddle_speed), paddle_accel(default_paddle_accel),
+      map(&map), reach(view_height)
+{
+    /* At most this many chunks are within reach, one more is loaded on each
+     * side and the bricks of the last one hang into the next.
+     */
+    const int32_t chunk   = map.get_chunk_height();
+    const int32_t chunks  = (2 * reach + chunk - 1) / chunk + 1;
+    band_height = std::min<int64_t>(height, (int64_t)(chunks + 3) * chunk);
+
+    // allocated up front, streaming doesn't allocate while playing
+    saved_start.resize(map.get_num_chunks() + 1, 0);
+    for (uint32_t c = 0; c < map.get_num_chunks(); c++)
+        saved_start[c + 1] = saved_start[c] + map.get_count(c);
+    saved.resize(map.get_num_bricks());
+    hit.resize(map.get_num_chunks(), false);
+
+    add_ball(default_ball(height));
+    stream();
+}
+
+void Simulation::build_grid(void)
+{
+    grid.reset(width, band.h, 64, band.y);
+    for (uint32_t i: blocks.get_alive())
+        grid.insert(i, blocks.get_rect(i));
+    grid.build();
+    candidates.reserve(blocks.size()); // a query reports a block only once
+}
+
+/* Keep the chunks around the lead ball loaded: everything within `reach'
+ * above and below it, plus a chunk on either side, so that a ball going back
+ * and forth across a chunk border doesn't reload them every time. The chunks
+ * next to those are prefetched, the ones that aren't needed anymore released.
+ * Other balls only hit the bricks in that band. Loading rebuilds `blocks' and
+ * the grid, block indices don't last past it.
+ */
+void Simulation::stream(void)
+{
+    if (!map) return;
+
+    const Ball& ball  = balls[lead];
+    uint32_t    first = map->find_chunk(ball.get_y() - reach);
+    uint32_t    end   = map->find_chunk(ball.get_y() + reach) + 1;
+    if (first >= first_chunk && end <= end_chunk) return;
+
+    first = first > 0 ? first - 1 : 0;
+    end   = std::min(end + 1, map->get_num_chunks());
+    save_chunks();
+    for (uint32_t c = first_chunk; c < end_chunk; c++)
+        if (c < first || c >= end) map->release(c);
+    if (first > 0)                   map->prefetch(first - 1);
+    if (end < map->get_num_chunks()) map->prefetch(end);
+    load_chunks(first, end);
+}
+
+/* Remember the strengths of the loaded bricks for the chunks that were hit.
+ * Those that never were are loaded from the map again.
+ */
+void Simulation::save_chunks(void)
+{
+    for (uint32_t c = first_chunk; c < end_chunk; c++) {
+        const level::Brick* bricks = map->get_bricks(c);
+        const uint32_t      count  = map->get_count(c);
+        const uint32_t      start  = chunk_start[c - first_chunk];
+        auto strength = [&](uint32_t i) -> uint8_t {
+            return blocks.is_alive(start + i) ? blocks.get_strength(start + i)
+                                              : 0;
+        };
+
+        bool changed = hit[c];
+        for (uint32_t i = 0; !changed && i < count; i++)
+            changed = strength(i) != bricks[i].strength;
+        if (!changed) continue;
+
+        hit[c] = true;
+        uint8_t* strengths = saved.data() + saved_start[c];
+        for (uint32_t i = 0; i < count; i++) strengths[i] = strength(i);
+    }
+}
+
+/* Replace `blocks' with the bricks of the chunks from `first' up to `end', as
+ * they were left (destroyed ones stay dead).
+ */
+void Simulation::load_chunks(uint32_t first, uint32_t end)
+{
+    blocks.clear();
+    chunk_start.clear();
+    for (uint32_t c = first; c < end; c++) {
+        const level::Brick* bricks    = map->get_bricks(c);
+        const uint8_t*      strengths = saved.data() + saved_start[c];
+        chunk_start.push_back(blocks.size());
+        for (uint32_t i = 0; i < map->get_count(c); i++) {
+            const level::Brick& b = bricks[i];
+            uint8_t  strength = hit[c] ? strengths[i] : b.strength;
+            uint32_t index = blocks.add({ b.x, b.y, b.w, b.h },
+                                        std::max<uint8_t>(strength, 1));
+            if (strength == 0) blocks.kill(index);
+        }
+    }
+    first_chunk = first;
+    end_chunk   = end;
+
+    const int32_t chunk  = map->get_chunk_height();
+    const int32_t top    = first * chunk;
+    const int32_t bottom = std::min<int64_t>(height, (int64_t)(end + 1)
+                                                     * chunk);
+    band = { 0, top, width, bottom - top };
+    build_grid();
+}
+
+void Simulation::remove_block(uint32_t index)
+{
+    grid.remove(index, blocks.get_rect(index));
+    blocks.kill(index);
+}
+
+/* Advance the simulation by exactly one tick. The returned events are only
+ * valid until the next call, the caller is expected to handle them right away
+ * (e.g. play a sound or change the screen).
+ */
+const std::vector<Simulation::Event>& Simulation::step(const Input& input)
+{
+    events.clear();
+    if (status != Status::RUNNING) return events;
+
+    player.save_position();
+    for (uint32_t i = 0; i < balls.size(); i++)
+        if (balls.is_alive(i)) balls[i].save_position();
+
+    update_player(input.right - input.left);
+    if (input.launch)
+        for (uint32_t i = 0; i < balls.size(); i++)
+            if (balls.is_alive(i)) balls[i].start();
+
+    move_balls();
+    stream();
+
+    return events;
+}
+
+/* Every ball can hit `max_contacts' bricks per tick, the events of those
+ * (plus LOST or WON) fit without allocating mid-game.
+ */
+void Simulation::add_ball(const Ball& ball)
+{
+    balls.add(ball);
+    events.reserve(balls.size() * max_contacts + 2);
+}
+
+void Simulation::emit(EventType type, const SDL_Rect& rect, uint32_t block)
+{
+    events.push_back({ type, rect, block });
+}
+
+/* For stress tests: add `n' balls on top of the paddle, each headed up at a
+ * random angle (from `seed') at the speed of the first ball. They're launched
+ * along with it, or right away if it's already moving.
+ */
+void Simulation::spawn_balls(uint32_t n, uint32_t seed)
+{
+    const Ball  first = default_ball(height);
+    const float speed = hypotf(first.get_xvel(), first.get_yvel());
+    auto random = [&](void) {
+        seed ^= seed << 13; // xorshift32
+        seed ^= seed >> 17;
+        seed ^= seed << 5;
+        return (seed >> 8) * (1.0f / 16777216.0f);
+    };
+
+    for (uint32_t i = 0; i < n; i++) {
+        float x     = player.get_xpos() + random() * player.get_width();
+        float angle = (0.15f + 0.7f * random()) * std::numbers::pi_v<float>;
+        Ball  ball(x, first.get_y(), 2 * first.get_radius());
+        ball.set_xvel(cosf(angle) * speed);
+        ball.set_yvel(-sinf(angle) * speed);
+        if (get_ball().is_started()) ball.start();
+        add_ball(ball);
+    }
+}
+
+/* The paddle's top speed (pixels per second) and how fast it gets there and
+ * back to a standstill (pixels per second squared).
+ */
+void Simulation::set_paddle_motion(float speed, float accel)
+{
+    paddle_speed = speed;
+    paddle_accel = accel;
+}
+
+/* Move the paddle for one tick. `direction' is -1 (left held), 1 (right held)
+ * or 0; the velocity changes towards the matching target by at most
+ * `paddle_accel * dt', so it's the same at any tick rate. The paddle stops
+ * dead at the walls.
+ */
+void Simulation::update_player(int32_t direction)
+{
+    float target = direction * paddle_speed;
+    float vel    = player.get_xvel();
+    float change = paddle_accel * dt;
+    vel = std::clamp(target, vel - change, vel + change);
+
+    float x     = player.get_x() + vel * dt;
+    float max_x = width - player.get_width();
+    if (x <= 0.0f || x >= max_x) {
+        x   = std::clamp(x, 0.0f, max_x);
+        vel = 0.0f;
+    }
+    player.set_xpos(x);
+    player.set_xvel(vel);
+}
+
+/* Move all balls through the tick, in one pass over the pool. A ball that
+ * leaves at the bottom is dropped, the game is lost with the last one. The
+ * lowest ball that's left becomes the lead.
+ */
+void Simulation::move_balls(void)
+{
+    float lowest = -INFINITY;
+    for (uint32_t i = 0; i < balls.size(); i++) {
+        if (!balls.is_alive(i)) continue;
+        Ball& ball = balls[i];
+        move_ball(ball);
+        if (status != Status::RUNNING) return;
+
+        if (ball.get_y() + ball.get_radius() >= height) {
+            balls.kill(i); // exit at bottom of screen
+        } else if (ball.get_y() > lowest) {
+            lowest = ball.get_y();
+            lead   = i;
+        }
+    }
+
+    if (balls.count() == 0) {
+        status = Status::LOST;
+        emit(EventType::LOST);
+    }
+}
+
+/* Move `ball' through the tick. The move is swept against the walls, the
+ * paddle and the bricks; at the earliest contact the ball is stopped, bounced
+ * and continues with the rest of the tick. That way, hits happen in the right
+ * order and nothing is skipped, no matter how fast the ball is. If the ball
+ * hits more than `max_contacts' things in one tick (wedged in somewhere), the
+ * rest of its move is dropped.
+ */
+void Simulation::move_ball(Ball& ball)
+{
+    if (!ball.is_started()) return;
+
+    float remaining = dt; // seconds of the tick that the ball still moves
+    for (uint32_t i = 0; i < max_contacts && remaining > 0.0f; i++) {
+        float dx = ball.get_xvel() * remaining;
+        float dy = ball.get_yvel() * remaining;
+
+        Contact  contact = { 1.0f, 0.0f, 0.0f };
+        Obstacle obstacle = Obstacle::NONE;
+        uint32_t block = 0;
+        sweep_walls(ball, dx, dy, &contact, &obstacle);
+
+        Contact c;
+        if (sweep_circle_rect(ball.get_x(), ball.get_y(), dx, dy,
+                              ball.get_radius(), player.get_rect(), &c) &&
+            c.t < contact.t) {
+            contact  = c;
+            obstacle = Obstacle::PLAYER;
+        }
+        sweep_blocks(ball, dx, dy, &contact, &obstacle, &block);
+
+        ball.update(remaining * contact.t);
+        remaining -= remaining * contact.t;
+
+        switch (obstacle) {
+        case Obstacle::NONE:   remaining = 0.0f;       break;
+        case Obstacle::WALL:   ball.reflect(contact);  break;
+        case Obstacle::PLAYER:
+            if (contact.ny < 0.0f) hit_player(ball); // top face or corner
+            else                   ball.reflect(contact);
+            break;
+        case Obstacle::BLOCK:
+            ball.reflect(contact);
+            hit_block(block);
+            if (status != Status::RUNNING) return;
+            break;
+        }
+    }
+}
+
+// The left, right and top walls; the bottom is open.
+void Simulation::sweep_walls(const Ball& ball, float dx, float dy,
+                             Contact* contact, Obstacle* obstacle) const
+{
+    float x = ball.get_x(), y = ball.get_y(), r = ball.get_radius();
+    auto  wall = [&](float t, float nx, float ny) {
+        t = std::max(t, 0.0f); // already past the wall
+        if (t < contact->t) {
+            *contact  = { t, nx, ny };
+            *obstacle = Obstacle::WALL;
+        }
+    };
+
+    if (dx < 0.0f) wall((r - x) / dx, 1.0f, 0.0f);
+    if (dx > 0.0f) wall((width - r - x) / dx, -1.0f, 0.0f);
+    if (dy < 0.0f) wall((r - y) / dy, 0.0f, 1.0f);
+}
+
+/* Find the first brick `ball' hits when moving by (dx,dy). The grid gives
+ * the bricks around the path, those that can't be reached at all (further
+ * away from the middle of the path than half its length plus the radius) are
+ * dropped in bulk before each remaining one is swept.
+ */
+void Simulation::sweep_blocks(const Ball& ball, float dx, float dy,
+                              Contact* contact, Obstacle* obstacle,
+                              uint32_t* block)
+{
+    float    x = ball.get_x(), y = ball.get_y(), r = ball.get_radius();
+    SDL_Rect bounds = { (int32_t)(std::min(x, x + dx) - r) - 1,
+                        (int32_t)(std::min(y, y + dy) - r) - 1,
+                        (int32_t)(fabsf(dx) + 2*r) + 3,
+                        (int32_t)(fabsf(dy) + 2*r) + 3 };
+    candidates.clear();
+    grid.query(bounds, candidates);
+
+    float    extent = r + sqrtf(dx*dx + dy*dy) / 2.0f; // around the middle
+    uint32_t n = blocks.filter_overlapping(x + dx/2.0f, y + dy/2.0f, extent,
+                                           candidates.data(),
+                                           candidates.size());
+    for (uint32_t i = 0; i < n; i++) {
+        Contact c;
+        if (sweep_circle_rect(x, y, dx, dy, r, blocks.get_rect(candidates[i]),
+                              &c) && c.t < contact->t) {
+            *contact  = c;
+            *obstacle = Obstacle::BLOCK;
+            *block    = candidates[i];
+        }
+    }
+}
+
+/* The paddle reflects the ball based on where it was hit (midpoint = straight
+ * up, left side = angle to left and proportional to distance from midpoint,
+ * right side same as left side).
+ */
+void Simulation::hit_player(Ball& ball)
+{
+    // NOTE: Vectors aren't normalized, so the ball will change its speed.
+    int32_t wzone = player.get_width() / player.num_zones;
+    int32_t diff  = std::max(1, (int32_t)ball.get_x() - player.get_xpos());
+    int32_t zone  = std::min<int32_t>(player.num_zones, diff / wzone + 1);
+
+    assert(zone > 0 && zone <= player.num_zones);
+    const Reflection& direction = reflections[zone - 1];
+    ball.set_xvel(direction.x * reference_rate);
+    ball.set_yvel(direction.y * reference_rate);
+}
+
+void Simulation::hit_block(uint32_t index)
+{
+    SDL_Rect rect = blocks.get_rect(index);
+    if (blocks.get_strength(index) <= 1) {
+        remove_block(index);
+        emit(EventType::BRICK_DESTROYED, rect, index);
+        if (++score >= winning_score) {
+            status = Status::WON;
+            emit(EventType::WON);
+        }
+    } else {
+        blocks.decrease_strength(index);
+        emit(EventType::BRICK_HIT, rect, index);
+    }
+}
+
+/* Positions for rendering are interpolated between the previous and the
+ * current tick, `alpha' being how far (in [0, 1]) the renderer is into the
+ * next tick. That way, the displayed motion is smooth even if the simulation
+ * and display rates don't match.
+ */
+SDL_Rect Player::get_rect(float alpha) const
+{
+    SDL_Rect r = rect;
+    r.x = (int32_t)(prev_x + (rect.x - prev_x) * alpha);
+    return r;
+}
+
+shapes::Circle Ball::get_circle(float alpha) const
+{
+    int32_t ix = (int32_t)(prev_x + (x - prev_x) * alpha);
+    int32_t iy = (int32_t)(prev_y + (y - prev_y) * alpha);
+    return shapes::Circle(ix, iy, w);
+}
+
+// Move the ball for `seconds', collisions are handled by the simulation.
+void Ball::update(float seconds)
+{
+    if (started) {
+        x += xvel * seconds;
+        y += yvel * seconds;
+    }
+}
+
+// Mirror the velocity at the surface with normal `contact.nx/ny'.
+void Ball::reflect(const Contact& contact)
+{
+    float dot = xvel*contact.nx + yvel*contact.ny;
+    if (dot >= 0.0f) return; // already moving away
+    xvel -= 2.0f * dot * contact.nx;
+    yvel -= 2.0f * dot * contact.ny;
+}
+
+// Put `ball' into a free slot, or a new one at the end. Returns its index.
+uint32_t BallPool::add(const Ball& ball)
+{
+    uint32_t index;
+    if (!free_slots.empty()) {
+        index = free_slots.back();
+        free_slots.pop_back();
+        balls[index] = ball;
+        alive[index] = true;
+    } else {
+        index = balls.size();
+        balls.push_back(ball);
+        alive.push_back(true);
+        free_slots.reserve(balls.capacity()); // see `kill()'
+    }
+    live++;
+    return index;
+}
+
+void BallPool::kill(uint32_t index)
+{
+    // `add()' made room for every slot, losing a ball doesn't allocate
+    alive[index] = false;
+    free_slots.push_back(index);
+    live--;
+}
@@ -0,0 +1,235 @@
+#ifndef _SIM_H_
+#define _SIM_H_
+
+#include <array>
+#include <cstdint>
+#include <SDL2/SDL_rect.h>
+#include <vector>
+
+#include "blocks.hh"
+#include "grid.hh"
+#include "level.hh"
+#include "shapes.hh"
+#include "sweep.hh"
+
+/* The simulation is everything that moves: paddle, ball and bricks. It must
+ * not depend on a window, renderer or audio device, so that it can be stepped
+ * as fast as possible in tooling (see `Makefile', it's built as a separate
+ * static library). The caller feeds one `Simulation::Input' per tick and gets
+ * back the events that happened during that tick.
+ */
+class Simulation;
+struct Player;
+struct Ball;
+class BallPool;
+struct Block;
+
+/* The paddle moves with a velocity (pixels per second) that follows the keys
+ * being held, speeding up and slowing down at a limited rate, see
+ * `Simulation::set_paddle_motion()'. Like the ball, it keeps its exact
+ * position in floating point, `rect' is rounded for collisions.
+ */
+struct Player {
+private:
+    SDL_Rect rect;
+    float    x;          // exact left edge
+    float    vel = 0.0f; // pixels per second, negative is left
+    int32_t  prev_x;     // position at the start of the last tick
+public:
+    static constexpr uint8_t num_zones = 10;
+    constexpr Player(int32_t x, int32_t y, int32_t w, int32_t h)
+        : rect({ x, y, w, h }), x(x), prev_x(x) {}
+
+    SDL_Rect get_rect(float) const;
+
+    constexpr void     save_position(void)    { prev_x = rect.x; }
+    constexpr void     set_ypos(int32_t y)    { rect.y = y; }
+    constexpr void     set_xpos(float x)      { this->x = x; rect.x = x; }
+    constexpr void     set_xvel(float v)      { vel = v; }
+    constexpr float    get_x(void) const      { return x; }
+    constexpr float    get_xvel(void) const   { return vel; }
+    constexpr int32_t  get_xpos(void) const   { return rect.x; }
+    constexpr int32_t  get_ypos(void) const   { return rect.y; }
+    constexpr int32_t  get_width(void) const  { return rect.w; }
+    constexpr int32_t  get_height(void) const { return rect.h; }
+    constexpr SDL_Rect get_rect(void) const   { return rect; }
+};
+
+/* The ball's position is kept in floating point and its velocity is given in
+ * pixels per second, so that the same ball moves the same distance per second
+ * regardless of the tick rate the simulation is run at.
+ */
+struct Ball {
+private:
+    float   x, y;           // midpoint coordinates
+    float   prev_x, prev_y; // midpoint at the start of the last tick
+    int32_t w;
+    bool    started = false;
+    float   xvel = 120.0f, yvel = 180.0f;
+public:
+    constexpr Ball(int32_t x, int32_t y, int32_t w)
+        : x(x), y(y), prev_x(x), prev_y(y), w(w) {}
+
+    void update(float);
+    void reflect(const Contact&);
+
+    shapes::Circle get_circle(float = 1.0f) const;
+
+    constexpr void  save_position(void)       { prev_x = x; prev_y = y; }
+    constexpr void  start(void)               { started = true; }
+    constexpr bool  is_started(void) const    { return started; }
+    constexpr float get_x(void) const         { return x; }
+    constexpr float get_y(void) const         { return y; }
+    constexpr float get_radius(void) const    { return w / 2; }
+    constexpr void  set_xvel(float v)         { xvel = v; }
+    constexpr void  set_yvel(float v)         { yvel = v; }
+    constexpr float get_xvel(void) const      { return xvel; }
+    constexpr float get_yvel(void) const      { return yvel; }
+};
+
+/* `BallPool' holds any number of balls in one contiguous array, so that the
+ * simulation moves all of them in a single pass. The slot of a lost ball goes
+ * on a free list and is taken by the next ball that's added; slots never
+ * move, so a ball keeps its index for as long as it's in play.
+ */
+class BallPool {
+    std::vector<Ball>     balls;
+    std::vector<uint8_t>  alive;
+    std::vector<uint32_t> free_slots; // of lost balls, reused first
+    uint32_t              live = 0;
+public:
+    uint32_t add(const Ball&);
+    void     kill(uint32_t);
+
+    uint32_t    size(void) const             { return balls.size(); }
+    uint32_t    count(void) const            { return live; }
+    bool        is_alive(uint32_t i) const   { return alive[i]; }
+    Ball&       operator[](uint32_t i)       { return balls[i]; }
+    const Ball& operator[](uint32_t i) const { return balls[i]; }
+};
+
+/* A block as it's described by a level, see `BlockStore' for how the
+ * simulation stores them.
+ */
+struct Block {
+private:
+    SDL_Rect rect;
+    uint8_t  strength; // how often it needs to be hit to disappear
+public:
+    constexpr Block(int32_t x, int32_t y, int32_t w, int32_t h, int8_t s)
+        : rect({ x, y, w, h }), strength(s) {}
+
+    constexpr int8_t   get_strength(void) const      { return strength; }
+    constexpr SDL_Rect get_rect(void) const          { return rect; }
+    constexpr int32_t  get_x(void) const             { return rect.x; }
+    constexpr int32_t  get_y(void) const             { return rect.y; }
+    constexpr int32_t  get_width(void) const         { return rect.w; }
+    constexpr int32_t  get_height(void) const        { return rect.h; }
+};
+
+class Simulation {
+public:
+    struct Input {
+        bool left   = false; // held down for this tick
+        bool right  = false;
+        bool launch = false; // release the ball from the paddle
+    };
+
+    enum class EventType { BRICK_HIT, BRICK_DESTROYED, LOST, WON };
+    struct Event {
+        EventType type;
+        SDL_Rect  rect;  // the brick that was hit, empty for LOST and WON
+        uint32_t  block; // its index in `get_blocks()', until it's streamed
+    };
+
+    enum class Status { RUNNING, WON, LOST };
+
+    /* Where the ball goes after it hit the paddle, for each of the paddle's
+     * zones from left to right, in pixels per frame at `reference_rate'. The
+     * direction isn't normalized, so the ball's speed changes with the zone
+     * too. It can be changed to tune it, see `breakout_batch'.
+     */
+    struct Reflection { float x, y; };
+    typedef std::array<Reflection, Player::num_zones> Reflections;
+    static const Reflections default_reflections;
+private:
+    enum class Obstacle { NONE, WALL, PLAYER, BLOCK };
+
+    const int32_t      width;
+    const int32_t      height;
+    const float        dt; // seconds per tick
+    Player             player;
+    BallPool           balls;
+    uint32_t           lead = 0;   // the lowest ball, the view follows it
+    BlockStore         blocks;
+    BlockGrid          grid;       // spatial index over `blocks'
+    SDL_Rect           band;       // the part of the level `blocks' covers
+    int32_t            band_height; // the most `band' will ever cover
+    std::vector<uint32_t> candidates; // reused by `sweep_blocks()'
+    uint32_t           score = 0;
+    uint32_t           winning_score = 15;
+    float              paddle_speed;
+    float              paddle_accel;
+    Reflections        reflections = default_reflections;
+    Status             status = Status::RUNNING;
+
+    std::vector<Event> events; // reused every tick, see `step()'
+
+    // a streamed level, see `stream()'
+    const level::Map*     map = nullptr;
+    int32_t               reach = 0; // above and below the ball
+    uint32_t              first_chunk = 0, end_chunk = 0; // loaded
+    std::vector<uint32_t> chunk_start; // index of each one's first block
+    std::vector<uint64_t> saved_start; // of every chunk in `saved'
+    std::vector<uint8_t>  saved; // strengths of all bricks, see `save_chunks()'
+    std::vector<uint8_t>  hit;   // per chunk, if its strengths are in `saved'
+
+    void update_player(int32_t);
+    void move_balls(void);
+    void move_ball(Ball&);
+    void sweep_walls(const Ball&, float, float, Contact*, Obstacle*) const;
+    void sweep_blocks(const Ball&, float, float, Contact*, Obstacle*,
+                      uint32_t*);
+    void hit_player(Ball&);
+    void hit_block(uint32_t);
+    void build_grid(void);
+    void stream(void);
+    void save_chunks(void);
+    void load_chunks(uint32_t, uint32_t);
+    void remove_block(uint32_t);
+    void add_ball(const Ball&);
+    void emit(EventType, const SDL_Rect& = { 0, 0, 0, 0 }, uint32_t = 0);
+public:
+    // Velocities used to be given in pixels per frame at 60 frames per second.
+    static constexpr float    reference_rate    = 60.0f;
+    static constexpr uint32_t default_tick_rate = 120;
+    static constexpr uint32_t max_contacts      = 8; // per tick
+    // full speed after 1/20 s, stopped just as fast
+    static constexpr float    default_paddle_speed = 900.0f;   // px/s
+    static constexpr float    default_paddle_accel = 18000.0f; // px/s^2
+
+    Simulation(int32_t, int32_t, uint32_t = default_tick_rate);
+    Simulation(int32_t, int32_t, const std::vector<Block>&,
+               uint32_t = default_tick_rate);
+    Simulation(const level::Map&, int32_t, uint32_t = default_tick_rate);
+
+    const std::vector<Event>& step(const Input&);
+    void set_paddle_motion(float, float);
+    void spawn_balls(uint32_t, uint32_t = 1);
+    void set_reflections(const Reflections& r) { reflections = r; }
+
+    constexpr Status   get_status(void) const       { return status; }
+    constexpr uint32_t get_score(void) const        { return score; }
+    constexpr int32_t  get_width(void) const        { return width; }
+    constexpr int32_t  get_height(void) const       { return height; }
+    constexpr float    get_dt(void) const           { return dt; }
+    const Player&      get_player(void) const       { return player; }
+    const Ball&        get_ball(void) const         { return balls[lead]; }
+    const BallPool&    get_balls(void) const        { return balls; }
+    const Reflections& get_reflections(void) const  { return reflections; }
+    const BlockStore&  get_blocks(void) const       { return blocks; }
+    const SDL_Rect&    get_band(void) const         { return band; }
+    constexpr int32_t  get_band_height(void) const  { return band_height; }
+};
+
+#endif /* _SIM_H_ */
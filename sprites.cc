@@ -0,0 +1,138 @@
+#include <algorithm>
+#include <filesystem>
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_image.h>
+
+#include "sprites.hh"
+
+/* Load every image in `directory' and pack them into pages. Files that aren't
+ * images (or that SDL_image can't read) are skipped. Images are placed on
+ * shelves, tallest first, which wastes little space for sprites of similar
+ * height. Returns an error message or `nullptr'.
+ */
+const char* SpriteAtlas::build(SDL_Renderer* renderer, const char* directory)
+{
+    release();
+
+    struct Image {
+        std::string  name;
+        SDL_Surface* surface;
+        uint32_t     page;
+        SDL_Rect     rect;
+    };
+    std::vector<Image> images;
+
+    std::error_code ec;
+    for (const auto& file: std::filesystem::directory_iterator(directory, ec)) {
+        if (!file.is_regular_file()) continue;
+        SDL_Surface* surface = IMG_Load(file.path().c_str());
+        if (surface)
+            images.push_back({ file.path().stem().string(), surface, 0,
+                               { 0, 0, surface->w, surface->h } });
+    }
+    if (ec) return "unable to read the texture directory";
+
+    std::sort(images.begin(), images.end(),
+              [](const Image& a, const Image& b) {
+                  if (a.rect.h != b.rect.h) return a.rect.h > b.rect.h;
+                  return a.name < b.name;
+              });
+
+    std::vector<SDL_Rect> extents; // used part of each page (x, y unused)
+    int32_t current = -1, pen_x = 0, pen_y = 0, shelf = 0;
+    for (Image& image: images) {
+        SDL_Rect& r = image.rect;
+        if (r.w > page_size || r.h > page_size) { // too large to share a page
+            image.page = extents.size();
+            extents.push_back({ 0, 0, r.w, r.h });
+            continue;
+        }
+
+        if (current >= 0 && pen_x + r.w > page_size) { // next shelf
+            pen_x  = 0;
+            pen_y += shelf;
+            shelf  = 0;
+        }
+        if (current < 0 || pen_y + r.h > page_size) { // next page
+            current = extents.size();
+            extents.push_back({ 0, 0, 0, 0 });
+            pen_x = pen_y = shelf = 0;
+        }
+
+        image.page = current;
+        r.x = pen_x;
+        r.y = pen_y;
+        pen_x += r.w + padding;
+        shelf  = std::max(shelf, r.h + padding);
+        extents[current].w = std::max(extents[current].w, r.x + r.w);
+        extents[current].h = std::max(extents[current].h, r.y + r.h);
+    }
+
+    const char* error = nullptr;
+    for (uint32_t p = 0; p < extents.size() && !error; p++) {
+        SDL_Surface* page = SDL_CreateRGBSurfaceWithFormat(
+                0, extents[p].w, extents[p].h, 32, SDL_PIXELFORMAT_RGBA32);
+        if (!page) {
+            error = SDL_GetError();
+            break;
+        }
+
+        for (Image& image: images) {
+            if (image.page != p || error) continue;
+            // copy the alpha channel as well instead of blending it away
+            SDL_SetSurfaceBlendMode(image.surface, SDL_BLENDMODE_NONE);
+            SDL_Rect dest = image.rect;
+            if (SDL_BlitSurface(image.surface, NULL, page, &dest) != 0)
+                error = SDL_GetError();
+        }
+
+        SDL_Texture* texture = nullptr;
+        if (!error) texture = SDL_CreateTextureFromSurface(renderer, page);
+        SDL_FreeSurface(page);
+        if (!texture) {
+            if (!error) error = SDL_GetError();
+            break;
+        }
+        SDL_SetTextureBlendMode(texture, SDL_BLENDMODE_BLEND);
+        pages.push_back(texture);
+    }
+
+    for (Image& image: images) {
+        if (!error) sprites[image.name] = { image.page, image.rect };
+        SDL_FreeSurface(image.surface);
+    }
+    if (error) release();
+    return error;
+}
+
+// NOTE: Must be called before the renderer that created the atlas is gone.
+void SpriteAtlas::release(void)
+{
+    for (SDL_Texture* page: pages) SDL_DestroyTexture(page);
+    pages.clear();
+    sprites.clear();
+}
+
+Sprite SpriteAtlas::get(const std::string& name) const
+{
+    auto it = sprites.find(name);
+    return it == sprites.end() ? Sprite() : it->second;
+}
+
+// Only the part `crop' (relative to the image's top left corner) of an image.
+Sprite SpriteAtlas::get(const std::string& name, const SDL_Rect& crop) const
+{
+    Sprite   sprite = get(name);
+    SDL_Rect bounds = { 0, 0, sprite.src.w, sprite.src.h };
+    SDL_Rect r;
+    if (!SDL_IntersectRect(&crop, &bounds, &r)) return Sprite();
+    sprite.src = { sprite.src.x + r.x, sprite.src.y + r.y, r.w, r.h };
+    return sprite;
+}
+
+void SpriteAtlas::draw(DrawQueue& queue, const Sprite& sprite,
+                       const SDL_Rect& dest) const
+{
+    if (sprite.page >= pages.size() || sprite.src.w == 0) return;
+    queue.texture(pages[sprite.page], &sprite.src, dest);
+}
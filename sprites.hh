@@ -0,0 +1,47 @@
+#ifndef _SPRITES_H_
+#define _SPRITES_H_
+
+#include <cstdint>
+#include <SDL2/SDL.h>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "draw.hh"
+
+/* A sprite is a rectangle on one of the pages of a `SpriteAtlas'. It's a
+ * plain value, drawing it doesn't need any lookups.
+ */
+struct Sprite {
+    uint32_t page = 0;
+    SDL_Rect src  = { 0, 0, 0, 0 }; // w == 0: not found
+};
+
+/* A `SpriteAtlas' packs all images of a directory into as few textures
+ * ("pages") as possible when it's built, so that all sprites on a page can be
+ * drawn in a single batch (see `DrawQueue'). Images are found by their file
+ * name without the extension, e.g. `brick' for `brick.png'. Images that are
+ * larger than a page get a page of their own.
+ */
+class SpriteAtlas {
+    static constexpr int32_t page_size = 2048;
+    static constexpr int32_t padding   = 1; // between sprites
+
+    std::vector<SDL_Texture*>               pages;
+    std::unordered_map<std::string, Sprite> sprites;
+public:
+    SpriteAtlas(void) = default;
+    SpriteAtlas(const SpriteAtlas&) = delete;
+    ~SpriteAtlas(void) { release(); }
+    SpriteAtlas& operator=(const SpriteAtlas&) = delete;
+
+    const char* build(SDL_Renderer*, const char*);
+    void        release(void);
+    Sprite      get(const std::string&) const;
+    Sprite      get(const std::string&, const SDL_Rect&) const;
+    void        draw(DrawQueue&, const Sprite&, const SDL_Rect&) const;
+
+    uint32_t get_num_pages(void) const { return pages.size(); }
+};
+
+#endif /* _SPRITES_H_ */
@@ -0,0 +1,42 @@
+#ifndef _SPSC_H_
+#define _SPSC_H_
+
+#include <atomic>
+#include <cstdint>
+
+/* A bounded, lock-free queue for exactly one producer thread and one consumer
+ * thread. Neither side ever blocks or allocates: `push()' fails if the queue
+ * is full, `pop()' fails if it's empty. `N' must be a power of two.
+ * Head and tail only ever increase (wrapping around), the slot is the counter
+ * modulo `N', so a full queue can be told apart from an empty one.
+ */
+template <typename T, uint32_t N>
+class SpscQueue {
+    static_assert(N > 0 && (N & (N - 1)) == 0, "N must be a power of two");
+
+    T items[N];
+    alignas(64) std::atomic<uint32_t> head = 0; // next slot to read
+    alignas(64) std::atomic<uint32_t> tail = 0; // next slot to write
+public:
+    // producer only
+    bool push(const T& item)
+    {
+        uint32_t t = tail.load(std::memory_order_relaxed);
+        if (t - head.load(std::memory_order_acquire) == N) return false;
+        items[t % N] = item;
+        tail.store(t + 1, std::memory_order_release);
+        return true;
+    }
+
+    // consumer only
+    bool pop(T* item)
+    {
+        uint32_t h = head.load(std::memory_order_relaxed);
+        if (h == tail.load(std::memory_order_acquire)) return false;
+        *item = items[h % N];
+        head.store(h + 1, std::memory_order_release);
+        return true;
+    }
+};
+
+#endif /* _SPSC_H_ */
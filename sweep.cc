@@ -0,0 +1,107 @@
+#include <algorithm>
+#include <cmath>
+
+#include "sweep.hh"
+
+/* First time in [0, 1] at which the circle at (x,y) moving by (dx,dy) touches
+ * the corner (cx,cy), i.e. the ray hits a circle of radius `r' around it.
+ */
+static bool sweep_corner(float x, float y, float dx, float dy, float r,
+                         float cx, float cy, Contact* contact)
+{
+    float fx = x - cx, fy = y - cy;
+    float a  = dx*dx + dy*dy;
+    float b  = fx*dx + fy*dy;
+    float c  = fx*fx + fy*fy - r*r;
+    if (a == 0.0f || b >= 0.0f) return false; // not moving towards the corner
+
+    float disc = b*b - a*c;
+    if (disc < 0.0f) return false;
+    float t = (-b - sqrtf(disc)) / a;
+    if (t < 0.0f || t > 1.0f) return false;
+
+    *contact = { t, (fx + t*dx) / r, (fy + t*dy) / r };
+    return true;
+}
+
+/* The ball already overlaps `rect' at the start of the move (that happens
+ * when the paddle is moved into it, or due to rounding right after a bounce).
+ * It only counts as a contact if the ball is moving further into the rect.
+ */
+static bool resolve_overlap(float x, float y, float dx, float dy, float r,
+                            const SDL_Rect& rect, Contact* contact)
+{
+    float x0 = rect.x, x1 = rect.x + rect.w;
+    float y0 = rect.y, y1 = rect.y + rect.h;
+    float qx = std::clamp(x, x0, x1), qy = std::clamp(y, y0, y1);
+    float ex = x - qx, ey = y - qy;
+    float d2 = ex*ex + ey*ey;
+    if (d2 >= r*r) return false;
+
+    float nx = 0.0f, ny = 0.0f;
+    if (d2 > 0.0f) {
+        float d = sqrtf(d2);
+        nx = ex / d;
+        ny = ey / d;
+    } else { // midpoint inside of the rect, push out the shortest way
+        float left = x - x0, right = x1 - x, top = y - y0, bottom = y1 - y;
+        float m = std::min({ left, right, top, bottom });
+        if      (m == left)  nx = -1.0f;
+        else if (m == right) nx = 1.0f;
+        else if (m == top)   ny = -1.0f;
+        else                 ny = 1.0f;
+    }
+    if (dx*nx + dy*ny >= 0.0f) return false;
+
+    *contact = { 0.0f, nx, ny };
+    return true;
+}
+
+/* Sweep a circle with midpoint (x,y) and radius `r' by (dx,dy) against
+ * `rect'. This is the same as casting a ray from the midpoint against the rect
+ * grown by `r' with rounded corners: the ray is clipped against the grown
+ * rect first and if it enters in one of the corner areas, it's tested against
+ * the rounded corner instead. Returns whether (and where) the circle hits.
+ */
+bool sweep_circle_rect(float x, float y, float dx, float dy, float r,
+                       const SDL_Rect& rect, Contact* contact)
+{
+    float x0 = rect.x, x1 = rect.x + rect.w;
+    float y0 = rect.y, y1 = rect.y + rect.h;
+
+    if (resolve_overlap(x, y, dx, dy, r, rect, contact)) return true;
+
+    // slab test against the grown rect
+    float tx0 = -INFINITY, tx1 = INFINITY, ty0 = -INFINITY, ty1 = INFINITY;
+    if (dx != 0.0f) {
+        tx0 = (x0 - r - x) / dx;
+        tx1 = (x1 + r - x) / dx;
+        if (tx0 > tx1) std::swap(tx0, tx1);
+    } else if (x < x0 - r || x > x1 + r) {
+        return false;
+    }
+    if (dy != 0.0f) {
+        ty0 = (y0 - r - y) / dy;
+        ty1 = (y1 + r - y) / dy;
+        if (ty0 > ty1) std::swap(ty0, ty1);
+    } else if (y < y0 - r || y > y1 + r) {
+        return false;
+    }
+
+    float enter = std::max(tx0, ty0), leave = std::min(tx1, ty1);
+    if (enter > leave || leave < 0.0f || enter > 1.0f) return false;
+
+    // where the ray enters (or starts, if it's inside of the grown rect)
+    float t  = std::max(enter, 0.0f);
+    float px = x + t*dx, py = y + t*dy;
+    bool  outside_x = px < x0 || px > x1;
+    bool  outside_y = py < y0 || py > y1;
+    if (outside_x && outside_y)
+        return sweep_corner(x, y, dx, dy, r, std::clamp(px, x0, x1),
+                            std::clamp(py, y0, y1), contact);
+    if (enter < 0.0f) return false; // touching a face, but not overlapping
+
+    if (tx0 > ty0) *contact = { enter, dx > 0.0f ? -1.0f : 1.0f, 0.0f };
+    else           *contact = { enter, 0.0f, dy > 0.0f ? -1.0f : 1.0f };
+    return true;
+}
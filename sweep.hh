@@ -0,0 +1,19 @@
+#ifndef _SWEEP_H_
+#define _SWEEP_H_
+
+#include <cstdint>
+#include <SDL2/SDL_rect.h>
+
+/* Continuous collision detection for the ball. Instead of testing whether the
+ * ball overlaps something after it moved, the whole move is tested, so a fast
+ * ball can't pass through a brick (or the paddle) between two ticks.
+ */
+struct Contact {
+    float t;      // time of impact as a fraction of the move, in [0, 1]
+    float nx, ny; // unit normal of the surface that was hit (pointing out)
+};
+
+bool sweep_circle_rect(float, float, float, float, float, const SDL_Rect&,
+                       Contact*);
+
+#endif /* _SWEEP_H_ */
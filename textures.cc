@@ -0,0 +1,149 @@
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_image.h>
+
+#include "textures.hh"
+
+/* Replace `*surface' by the part of it inside `crop'. Returns an error
+ * message or `nullptr' (in which case `*surface' is left alone).
+ */
+static const char* crop_surface(SDL_Surface** surface, const SDL_Rect& crop)
+{
+    SDL_Surface* cropped = SDL_CreateRGBSurfaceWithFormat(
+            0, crop.w, crop.h, 32, SDL_PIXELFORMAT_RGBA32);
+    if (!cropped) return SDL_GetError();
+
+    // copy the pixels as they are instead of blending them onto nothing
+    SDL_Rect src = crop;
+    SDL_SetSurfaceBlendMode(*surface, SDL_BLENDMODE_NONE);
+    if (SDL_BlitSurface(*surface, &src, cropped, NULL) != 0) {
+        SDL_FreeSurface(cropped);
+        return SDL_GetError();
+    }
+
+    SDL_FreeSurface(*surface);
+    *surface = cropped;
+    return nullptr;
+}
+
+/* Register the image at `path', cropped to `crop' if given. Nothing is
+ * loaded yet, but asking for the same path and crop again returns the same
+ * handle.
+ */
+TextureCache::Handle TextureCache::acquire(const char* path,
+                                           const SDL_Rect* crop)
+{
+    SDL_Rect    r   = crop ? *crop : SDL_Rect{ 0, 0, 0, 0 };
+    std::string key = std::string(path) + '@' + std::to_string(r.x) + ',' +
+                      std::to_string(r.y) + ',' + std::to_string(r.w) + ',' +
+                      std::to_string(r.h);
+
+    auto it = lookup.find(key);
+    if (it != lookup.end()) return it->second;
+
+    Handle handle = entries.size();
+    entries.emplace_back();
+    entries.back().path = path;
+    entries.back().crop = r;
+    lookup.emplace(key, handle);
+    return handle;
+}
+
+/* The texture for `handle', loaded if necessary. Marks it as used in the
+ * current frame. On failure `nullptr' is returned and `*error' is set.
+ */
+SDL_Texture* TextureCache::get(SDL_Renderer* renderer, Handle handle,
+                               const char** error)
+{
+    if (handle >= entries.size()) {
+        if (error) *error = "invalid texture handle";
+        return nullptr;
+    }
+
+    Entry& entry = entries[handle];
+    if (!entry.texture) {
+        if (const char* msg = load(renderer, entry)) {
+            if (error) *error = msg;
+            return nullptr;
+        }
+        touch(handle);
+        evict();
+    } else if (entry.last_used != frame) {
+        touch(handle);
+    }
+    return entry.texture;
+}
+
+const char* TextureCache::load(SDL_Renderer* renderer, Entry& entry)
+{
+    SDL_Surface* surface = IMG_Load(entry.path.c_str());
+    if (!surface) return IMG_GetError();
+
+    if (entry.crop.w > 0 && entry.crop.h > 0) {
+        if (const char* error = crop_surface(&surface, entry.crop)) {
+            SDL_FreeSurface(surface);
+            return error;
+        }
+    }
+
+    SDL_Texture* texture = SDL_CreateTextureFromSurface(renderer, surface);
+    SDL_FreeSurface(surface);
+    if (!texture) return SDL_GetError();
+
+    uint32_t format;
+    int32_t  w, h;
+    SDL_QueryTexture(texture, &format, NULL, &w, &h);
+    entry.texture = texture;
+    entry.bytes   = (uint64_t)w * h * SDL_BYTESPERPIXEL(format);
+    used += entry.bytes;
+    return nullptr;
+}
+
+void TextureCache::unlink(Handle handle)
+{
+    Entry& entry = entries[handle];
+    if (entry.prev != none) entries[entry.prev].next = entry.next;
+    else if (head == handle) head = entry.next;
+    if (entry.next != none) entries[entry.next].prev = entry.prev;
+    else if (tail == handle) tail = entry.prev;
+    entry.prev = entry.next = none;
+}
+
+// Move `handle' to the front of the LRU list.
+void TextureCache::touch(Handle handle)
+{
+    unlink(handle);
+    Entry& entry = entries[handle];
+    entry.last_used = frame;
+    entry.next = head;
+    if (head != none) entries[head].prev = handle;
+    head = handle;
+    if (tail == none) tail = handle;
+}
+
+// Destroy the least recently used textures until the budget is met.
+void TextureCache::evict(void)
+{
+    while (used > budget && tail != none &&
+           entries[tail].last_used != frame) {
+        Handle handle = tail;
+        Entry& entry  = entries[handle];
+        unlink(handle);
+        SDL_DestroyTexture(entry.texture);
+        entry.texture = nullptr;
+        used -= entry.bytes;
+        entry.bytes = 0;
+    }
+}
+
+// Destroy all textures, handles stay valid.
+void TextureCache::clear(void)
+{
+    for (Entry& entry: entries) {
+        if (entry.texture) SDL_DestroyTexture(entry.texture);
+        entry.texture = nullptr;
+        entry.bytes   = 0;
+        entry.prev    = entry.next = none;
+    }
+    head = tail = none;
+    used = 0;
+}
@@ -0,0 +1,63 @@
+#ifndef _TEXTURES_H_
+#define _TEXTURES_H_
+
+#include <cstdint>
+#include <SDL2/SDL.h>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/* The `TextureCache' loads image files (optionally cropped) into textures.
+ * Every distinct (path, crop) pair is registered once and gets a `Handle' that
+ * stays valid for the lifetime of the cache, drawing by handle is just an
+ * array lookup.
+ * The cache keeps track of how much texture memory it uses. If that exceeds
+ * the budget, the least recently used textures are destroyed; their handles
+ * stay valid and the texture is loaded again the next time it's needed.
+ * Textures used during the current frame are never evicted (the draw queue
+ * still refers to them), so the budget may be exceeded until `next_frame()'.
+ */
+class TextureCache {
+public:
+    typedef uint32_t Handle;
+    static constexpr Handle invalid = UINT32_MAX;
+private:
+    static constexpr uint32_t none = UINT32_MAX; // end of the LRU list
+
+    struct Entry {
+        std::string  path;
+        SDL_Rect     crop;              // w == 0: the whole image
+        SDL_Texture* texture = nullptr; // nullptr if not loaded (or evicted)
+        uint64_t     bytes = 0;
+        uint64_t     last_used = 0;     // frame
+        uint32_t     prev = none, next = none; // LRU list, see `touch()'
+    };
+
+    std::vector<Entry>                      entries; // indexed by handle
+    std::unordered_map<std::string, Handle> lookup;
+    uint32_t head = none, tail = none; // most/least recently used
+    uint64_t budget;
+    uint64_t used = 0;  // bytes of all loaded textures
+    uint64_t frame = 1;
+
+    const char* load(SDL_Renderer*, Entry&);
+    void        unlink(Handle);
+    void        touch(Handle);
+    void        evict(void);
+public:
+    explicit TextureCache(uint64_t budget) : budget(budget) {}
+    TextureCache(const TextureCache&) = delete;
+    ~TextureCache(void) { clear(); }
+    TextureCache& operator=(const TextureCache&) = delete;
+
+    Handle       acquire(const char*, const SDL_Rect* = nullptr);
+    SDL_Texture* get(SDL_Renderer*, Handle, const char** = nullptr);
+    void         next_frame(void) { frame++; evict(); }
+    void         clear(void);
+
+    void     set_budget(uint64_t bytes) { budget = bytes; evict(); }
+    uint64_t get_budget(void) const     { return budget; }
+    uint64_t get_used(void) const       { return used; }
+};
+
+#endif /* _TEXTURES_H_ */
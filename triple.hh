@@ -0,0 +1,46 @@
+#ifndef _TRIPLE_H_
+#define _TRIPLE_H_
+
+#include <atomic>
+#include <cstdint>
+
+/* A lock-free triple buffer for exactly one writer thread and one reader
+ * thread. The writer fills its back buffer and `publish()'es it, the reader
+ * `update()'s to the latest published buffer and reads it for as long as it
+ * likes. Neither side ever waits for the other; values the reader didn't get
+ * to before the next `publish()' are simply skipped.
+ * The three buffers change hands through `middle' (its index plus a flag for
+ * whether the writer put something new there since the reader last took it).
+ */
+template <typename T>
+class TripleBuffer {
+    static constexpr uint8_t fresh = 0x4;
+    static constexpr uint8_t index = 0x3;
+
+    T buffers[3];
+    alignas(64) std::atomic<uint8_t> middle = 2;
+    alignas(64) uint8_t              back   = 1; // writer only
+    alignas(64) uint8_t              front  = 0; // reader only
+public:
+    explicit TripleBuffer(const T& initial)
+        : buffers { initial, initial, initial } {}
+
+    // writer only
+    T& get_back(void) { return buffers[back]; }
+    void publish(void)
+    {
+        back = middle.exchange(back | fresh, std::memory_order_acq_rel)
+               & index;
+    }
+
+    // reader only, returns false if nothing was published since the last call
+    bool update(void)
+    {
+        if (!(middle.load(std::memory_order_relaxed) & fresh)) return false;
+        front = middle.exchange(front, std::memory_order_acq_rel) & index;
+        return true;
+    }
+    const T& get_front(void) const { return buffers[front]; }
+};
+
+#endif /* _TRIPLE_H_ */
@@ -41,7 +41,9 @@ ui::Text::Text(const ui::Text& other)
 }
 
 /* Add this button to the renderer of the given context. It's important to note
- * that the caller must still invoke `render_present()' on the context.
+ * that the caller must still invoke `render_present()' on the context. It's
+ * drawn into the current layer, so whatever is below it (like the background
+ * of a menu) has to be in an earlier one, see `DrawQueue'.
  * TODO:
  * improve button press event cascading
  * improve ui button storage in game class
@@ -68,7 +70,7 @@ bool ui::Button::render(Context& context, int32_t x, int32_t y, bool pressed)
         context.draw_rectangle(grey1-70, shadow1, false);
         context.draw_rectangle(grey2-70, shadow2, false);
         context.draw_rectangle(grey3-70, shadow3, false);
-        callback(user_data);
+        if (callback) callback(user_data);
     } else {
         context.draw_rectangle(green0, rect);
         context.draw_rectangle(grey1, shadow1, false);
@@ -86,11 +88,12 @@ bool ui::Button::render(Context& context, int32_t x, int32_t y, bool pressed)
  * determined such that the rendering routine doesn't need to care about
  * calculating anything.
  */
-void ui::Button::add_text(const std::string& text, TTF_Font* font)
+void ui::Button::add_text(const std::string& text, TTF_Font* font,
+                          const Context& context)
 {
     assert(font);
-    int w, h;
-    TTF_SizeText(font, text.c_str(), &w, &h);
+    int32_t w, h;
+    context.measure_text(text, &w, &h, font);
     if (w > rect.w || h > rect.h) {
         std::cerr << "error: button text is too long\n";
         exit(1);
@@ -2,10 +2,10 @@
 #define _UI_H_
 
 #include <cstdint>
-#include <functional>
 #include <SDL2/SDL.h>
 #include <SDL2/SDL_ttf.h>
 #include <string>
+#include <utility>
 
 #include "context.hh"
 
@@ -22,7 +22,7 @@ namespace ui {
         Text(const std::string& t, int32_t x, int32_t y, int32_t w, int32_t h)
             : text(t), x(x), y(y), w(w), h(h) {}
         Text(const Text&);
-        Text(Text&&) = delete;
+        Text(Text&&) noexcept = default;
         ~Text(void) = default;
         Text& operator=(Text);
 
@@ -49,9 +49,10 @@ class ui::Button {
     SDL_Rect rect;
     Text     text = Text();
 
-    typedef std::function<void(void*)> cb_fn;
-    cb_fn callback;
-    void* user_data;
+    // a plain function pointer, copying a button never allocates for it
+    typedef void (*cb_fn)(void*);
+    cb_fn callback  = nullptr;
+    void* user_data = nullptr;
 
     constexpr static SDL_Color black0 = { 40, 40, 40, 255 };
     constexpr static SDL_Color green0 = { 160, 220, 100, 255 };
@@ -64,11 +65,13 @@ public:
     Button(int32_t x, int32_t y, int32_t w, int32_t h)
         : rect({ x, y, w, h }) {}
     Button(const Button&);
-    Button(Button&& other) noexcept { rect = other.rect; text = other.text; }
+    Button(Button&& other) noexcept
+        : rect(other.rect), text(std::move(other.text)),
+          callback(other.callback), user_data(other.user_data) {}
     ~Button(void) {}
     Button& operator=(Button);
 
-    void add_text(const std::string& text, TTF_Font*);
+    void add_text(const std::string& text, TTF_Font*, const Context&);
     bool render(Context& context, int32_t, int32_t, bool = false);
 
     void add_callback(cb_fn fn, void* ud) { callback = fn; user_data = ud; }